@@ -36,9 +36,15 @@ other dealings in this Software without prior written authorization.
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdio>
 #include <cstring>
 #include <deque>
 #include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -46,8 +52,25 @@ other dealings in this Software without prior written authorization.
 #include <string>
 #include <thread>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
+// C++20 coroutine support is optional: co_store() and co_retrieve() are only available when the compiler supports them.
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#define VALUSTOR_COROUTINES
+#endif
+
+// The shared memory cache and the backlog journal are only available on POSIX systems.
+#if defined(__unix__)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 // See https://github.com/datastax/cpp-driver/releases
 // This has been tested with version 2.7.1.
 #include <cassandra.h>
@@ -145,6 +168,269 @@ class ValuStorUUIDGen{
     }
 };
 
+// ****************************************************************************************************
+/// @class         ValuStorSharedCache
+///
+/// @brief         A fixed-size hash table of serialized values in POSIX shared memory (/dev/shm), which every process
+///                on the host that opens the same name shares as a cache.
+///                It is lock-free: each slot has a sequence number that is odd while the slot is being written.
+///                A writer claims a slot by compare-and-swap, skipping it if another writer has it, and a reader
+///                retries elsewhere if the sequence changed while it copied the slot.
+///                Expiry uses the monotonic clock, which all processes on the host share.
+///
+class ValuStorSharedCache{
+  private:
+    class Slot
+    {
+      public:
+        std::atomic<uint64_t> sequence;
+        uint64_t key_hash;
+        std::atomic<int64_t> expires_at_ms; // Atomic so that erase() can expire a slot that another writer has claimed.
+        int64_t write_time;
+        uint32_t key_size;   // '0' if the slot is empty.
+        uint32_t value_size;
+        // Followed by the key and value bytes.
+    };
+
+    static const uint64_t magic = 0x56616c7553746f72ULL; // "ValuStor"
+    static const size_t header_bytes = 64;               // magic, slot count, slot bytes
+    static const size_t probes = 4;                      // Slots a key may be stored in, starting at its hash.
+    static const size_t erase_attempts = 64;             // Tries to claim a busy slot before erase() just expires it.
+
+    void* memory;
+    size_t memory_bytes;
+    size_t slot_count;
+    size_t slot_bytes;
+    const int64_t ttl_ms;
+
+    //
+    // FNV-1a, which unlike std::hash is the same in every process.
+    //
+    static uint64_t hash(const std::string& key){
+      uint64_t hash = 0xcbf29ce484222325ULL;
+      for(char c : key){
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ULL;
+      }
+      return hash;
+    }
+
+    static int64_t now_ms(void){
+      return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    Slot& slot(uint64_t key_hash, size_t probe){
+      return *reinterpret_cast<Slot*>(static_cast<char*>(this->memory) + header_bytes +
+                                      ((key_hash + probe) % this->slot_count) * this->slot_bytes);
+    }
+
+    static char* bytes(Slot& slot){
+      return reinterpret_cast<char*>(&slot) + sizeof(Slot);
+    }
+
+    size_t capacity(void) const{
+      return this->slot_bytes - sizeof(Slot);
+    }
+
+    // ****************************************************************************************************
+    /// @name            claim
+    ///
+    /// @brief           Mark a slot as being written, unless another writer already has it.
+    ///
+    /// @return          The sequence number to pass to publish(), or '0' if the slot is busy.
+    ///
+    static uint64_t claim(Slot& slot){
+      uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+      if((sequence & 1) != 0 or not slot.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acq_rel)){
+        return 0;
+      }
+      return sequence + 2;
+    }
+
+    static void publish(Slot& slot, uint64_t sequence){
+      slot.sequence.store(sequence, std::memory_order_release);
+    }
+
+    bool holds(Slot& slot, uint64_t key_hash, const std::string& key){
+      return slot.key_hash == key_hash and slot.key_size == key.size() and std::memcmp(bytes(slot), key.data(), key.size()) == 0;
+    }
+
+  public:
+    // ****************************************************************************************************
+    /// @name            constructor
+    ///
+    /// @brief           Open, or create, the named shared memory. Check is_open() for success.
+    ///                  Processes must agree on the slot count and size, otherwise the later ones fail to open it.
+    ///
+    /// @param           name         The shared memory object name, e.g. "/valustor.cache.values".
+    /// @param           slot_count
+    /// @param           slot_bytes   The size of each slot. Entries whose key and value don't fit aren't shared.
+    /// @param           ttl_ms       The longest an entry lives.
+    ///
+    ValuStorSharedCache(const std::string& name, size_t slot_count, size_t slot_bytes, int64_t ttl_ms):
+      memory(nullptr),
+      memory_bytes(header_bytes + slot_count * slot_bytes),
+      slot_count(slot_count),
+      slot_bytes(slot_bytes),
+      ttl_ms(ttl_ms)
+    {
+      #if defined(__unix__)
+      if(slot_count == 0 or slot_bytes <= sizeof(Slot) or slot_bytes % alignof(Slot) != 0){
+        return;
+      }
+      int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+      if(fd < 0){
+        return;
+      }
+      struct stat status;
+      if(fstat(fd, &status) == 0 and (static_cast<size_t>(status.st_size) == this->memory_bytes or
+                                       (status.st_size == 0 and ftruncate(fd, this->memory_bytes) == 0))){
+        void* memory = mmap(nullptr, this->memory_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(memory != MAP_FAILED){
+          //
+          // New shared memory is zero filled, which is a table of empty slots. Whoever gets there first labels it.
+          //
+          uint64_t* header = static_cast<uint64_t*>(memory);
+          if(header[0] == 0){
+            header[1] = slot_count;
+            header[2] = slot_bytes;
+            header[0] = magic;
+          }
+          if(header[0] == magic and header[1] == slot_count and header[2] == slot_bytes){
+            this->memory = memory;
+          }
+          else{
+            munmap(memory, this->memory_bytes);
+          }
+        }
+      }
+      close(fd);
+      #else
+      (void)name;
+      #endif
+    }
+
+    ~ValuStorSharedCache(void){
+      #if defined(__unix__)
+      if(this->memory != nullptr){
+        munmap(this->memory, this->memory_bytes);
+      }
+      #endif
+    }
+
+    bool is_open(void) const{
+      return this->memory != nullptr;
+    }
+
+    // ****************************************************************************************************
+    /// @name            find
+    ///
+    /// @brief           Copy out the unexpired value stored for the key.
+    ///
+    /// @return          'true' if found.
+    ///
+    bool find(const std::string& key, std::string* value){
+      uint64_t key_hash = hash(key);
+      int64_t now = now_ms();
+      for(size_t probe = 0; probe < probes; probe++){
+        Slot& slot = this->slot(key_hash, probe);
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if((sequence & 1) != 0 or slot.key_hash != key_hash or slot.key_size != key.size()){
+          continue;
+        }
+        size_t value_size = slot.value_size;
+        bool is_match = key.size() + value_size <= this->capacity() and slot.expires_at_ms > now and
+                        std::memcmp(bytes(slot), key.data(), key.size()) == 0;
+        if(is_match){
+          value->assign(bytes(slot) + key.size(), value_size);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(is_match and slot.sequence.load(std::memory_order_relaxed) == sequence){
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // ****************************************************************************************************
+    /// @name            insert
+    ///
+    /// @brief           Store a value for the key, unless a newer write is already stored.
+    ///                  It replaces the key's current slot, an empty or expired slot, or the slot closest to expiring.
+    ///                  A value that doesn't fit just removes the key. If the slot is busy, nothing is stored.
+    ///
+    /// @param           max_lifetime_ms  The entry expires sooner than 'ttl_ms' if this is shorter, e.g. the row's TTL.
+    /// @param           write_time       In microseconds since the epoch, or '0' if unknown.
+    ///
+    void insert(const std::string& key, const std::string& value, int64_t max_lifetime_ms, int64_t write_time){
+      int64_t lifetime_ms = std::min(this->ttl_ms, max_lifetime_ms);
+      if(key.size() + value.size() > this->capacity() or lifetime_ms <= 0){
+        this->erase(key);
+        return;
+      }
+
+      uint64_t key_hash = hash(key);
+      int64_t now = now_ms();
+      Slot* target = nullptr;
+      for(size_t probe = 0; probe < probes and (target == nullptr or target->key_hash != key_hash); probe++){
+        Slot& slot = this->slot(key_hash, probe);
+        if(target == nullptr or slot.key_hash == key_hash or
+           (target->key_size != 0 and target->expires_at_ms > now and slot.expires_at_ms < target->expires_at_ms)){
+          target = &slot;
+        }
+      }
+
+      int64_t expires_at_ms = target->expires_at_ms.load(std::memory_order_acquire); // Read before the claim, see erase().
+      uint64_t sequence = claim(*target);
+      if(sequence != 0){
+        if(not (write_time != 0 and this->holds(*target, key_hash, key) and target->write_time > write_time and target->expires_at_ms > now)){
+          target->key_hash = key_hash;
+          target->expires_at_ms.compare_exchange_strong(expires_at_ms, now + lifetime_ms);
+          target->write_time = write_time;
+          target->key_size = key.size();
+          target->value_size = value.size();
+          std::memcpy(bytes(*target), key.data(), key.size());
+          std::memcpy(bytes(*target) + key.size(), value.data(), value.size());
+        }
+        publish(*target, sequence);
+      }
+    }
+
+    // ****************************************************************************************************
+    /// @name            erase
+    ///
+    /// @brief           Remove the key, e.g. because it was just stored with a value that isn't shared.
+    ///                  An invalidation is never dropped: if the slot stays busy, it is marked expired instead.
+    ///
+    void erase(const std::string& key){
+      uint64_t key_hash = hash(key);
+      for(size_t probe = 0; probe < probes; probe++){
+        Slot& slot = this->slot(key_hash, probe);
+        if(slot.key_hash == key_hash){
+          uint64_t sequence = claim(slot);
+          for(size_t attempt = 1; sequence == 0 and attempt < erase_attempts; attempt++){
+            std::this_thread::yield();
+            sequence = claim(slot);
+          }
+          if(sequence != 0){
+            if(this->holds(slot, key_hash, key)){
+              slot.key_hash = 0;
+              slot.key_size = 0;
+              slot.expires_at_ms = 0;
+            }
+            publish(slot, sequence);
+          }
+          else{
+            //
+            // The writer that holds the slot sets the expiry only if it hasn't changed since before its claim, so this sticks.
+            // The key can't be checked without the claim, so a colliding key may be expired with it. That only costs a miss.
+            //
+            slot.expires_at_ms.store(0, std::memory_order_release);
+          }
+        }
+      }
+    }
+};
+
 // ****************************************************************************************************
 /// @class         ValuStor
 ///
@@ -167,8 +453,13 @@ class ValuStor
         const std::string result_message;
         const Val_T data;
         std::vector<std::pair<Val_T, std::tuple<Keys...>>> results;
+        bool is_stale; // 'true' if 'data' is an expired value from the cache, rather than read from the database.
+        CassConsistency consistency; // The level the database answered at, or CASS_CONSISTENCY_UNKNOWN if it didn't.
 
       private:
+        std::vector<int32_t> seconds_ttls; // TTL() of each row in 'results', when 'select_ttl_writetime' is enabled.
+        std::vector<int64_t> write_times;  // WRITETIME() of each row in 'results', when 'select_ttl_writetime' is enabled.
+
         // ****************************************************************************************************
         /// @name            Result
         ///
@@ -178,7 +469,9 @@ class ValuStor
           error_code(error_code),
           result_message(result_message),
           data(result_data),
-          results({std::make_pair(this->data, std::move(keys))})
+          results({std::make_pair(this->data, std::move(keys))}),
+          is_stale(false),
+          consistency(CASS_CONSISTENCY_UNKNOWN)
         {}
 
         // ****************************************************************************************************
@@ -190,7 +483,9 @@ class ValuStor
           error_code(error_code),
           result_message(result_message),
           data(resulting_data.size() > 0 ? resulting_data.at(0).first : Val_T{}),
-          results(std::move(resulting_data))
+          results(std::move(resulting_data)),
+          is_stale(false),
+          consistency(CASS_CONSISTENCY_UNKNOWN)
         {}
 
       public:
@@ -211,637 +506,3306 @@ class ValuStor
         }
     };
 
-  private:
-    CassCluster* cluster;
-    CassSession* session;
-    const CassPrepared* prepared_insert;
-    std::map<size_t, const CassPrepared*> prepared_selects;
-
-    std::atomic<bool> is_initialized;
-    std::thread backlog_thread;
-    InsertMode_t default_backlog_mode;
-    std::vector<CassConsistency> read_consistencies;
-    std::vector<CassConsistency> write_consistencies;
-    std::atomic<bool>* do_terminate_thread_ptr;
-    std::shared_ptr<std::atomic<bool>> is_processing_backlog_ptr;
-    std::mutex* backlog_mutex_ptr;
-    std::deque<std::tuple<std::tuple<Keys...>,Val_T,int32_t,int64_t>>* backlog_queue_ptr;
-    std::vector<std::string> keys;
-
-    std::map<std::string, std::string> config;
-    const std::map<std::string, std::string> default_config = {
-        {"table", "cache.values"},
-        {"key_field", "key_field"},
-        {"value_field", "value_field"},
-        {"username", "username"},
-        {"password", "password"},
-        {"hosts", "127.0.0.1"},
-        {"port", "9042"},
-        {"read_consistencies", "LOCAL_QUORUM, LOCAL_ONE, ONE"},
-        {"write_consistencies", "LOCAL_ONE, ONE, ANY"},
-        {"client_io_threads", "2"},
-        {"client_queue_size", "8192"},
-        {"client_server_connects_per_thread", "1"},
-        {"client_max_connects_per_thread", "2"},
-        {"client_max_conc_connect_creation", "1"},
-        {"client_max_concurrent_requests", "100"},
-        {"client_log_level", "2"},
-        {"default_backlog_mode", "1"},
-        {"server_trusted_cert", ""},
-        {"server_verify_mode", "0"},
-        {"client_ssl_cert", ""},
-        {"client_ssl_key", ""},
-        {"client_key_password", ""}
-      };
-
-  private:
     // ****************************************************************************************************
-    /// @name            trim
-    ///
-    /// @brief           Trim the leading and trailing space from a string and return it.
-    ///
-    /// @param           str
+    /// @typedef       Callback
     ///
-    /// @return          copy of the trimmed string.
+    /// @brief         Completion handler for the non-blocking store() and retrieve() overloads.
     ///
-    static std::string trim(const std::string str){
-      std::string s = str;
-      s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](int c) {
-        return not std::isspace(c);
-      }));
-      s.erase(std::find_if(s.rbegin(), s.rend(), [](int c) {
-        return not std::isspace(c);
-      }).base(), s.end());
-      return s;
-    } // trim()
+    typedef std::function<void(ValuStor::Result)> Callback;
 
+    #if defined(VALUSTOR_COROUTINES)
     // ****************************************************************************************************
-    /// @name            str_to_int
+    /// @class         Awaitable
     ///
-    /// @brief           Convert a string to an integer, using a default value if an exception is thrown.
+    /// @brief         The co_await-able result of co_store() and co_retrieve().
+    ///                The coroutine is resumed directly from the driver callback, so there are no extra thread hops.
+    ///                If the request completes before the coroutine has suspended, it simply doesn't suspend.
     ///
-    /// @param           str
-    /// @param           default_value
+    class Awaitable
+    {
+      friend class ValuStor;
+
+      private:
+        std::function<void(Callback)> start;
+        std::unique_ptr<ValuStor::Result> result;
+        std::coroutine_handle<> handle;
+        std::atomic<bool> is_other_side_done;
+
+        Awaitable(std::function<void(Callback)>&& start):
+          start(std::move(start)),
+          is_other_side_done(false)
+        {}
+
+      public:
+        Awaitable(Awaitable&& that):
+          start(std::move(that.start)),
+          is_other_side_done(false)
+        {}
+
+        bool await_ready(void) const{
+          return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> coroutine){
+          this->handle = coroutine;
+          this->start([this](ValuStor::Result result){
+            this->result.reset(new ValuStor::Result(std::move(result)));
+            if(this->is_other_side_done.exchange(true)){
+              this->handle.resume();
+            }
+          });
+          //
+          // Whichever side finishes second is responsible for continuing the coroutine.
+          //
+          return not this->is_other_side_done.exchange(true);
+        }
+
+        ValuStor::Result await_resume(void){
+          return std::move(*this->result);
+        }
+    };
+    #endif
+
+  private:
+    class Request;
+
+    // ****************************************************************************************************
+    /// @class         CircuitBreaker
     ///
-    /// @return          The integer value converted from the string, or the default value on an error.
+    /// @brief         The recent health of one entry in 'read_consistencies' or 'write_consistencies'.
+    ///                After 'consistency_failure_threshold' consecutive failures the level is skipped until 'retry_at',
+    ///                when a single request is let through to probe it. A success closes the breaker again.
     ///
-    static int str_to_int(std::string str, int default_value){
-      try{
-        return std::stoi(str);
-      }
-      catch(const std::exception& exception){
-        return default_value;
-      } // catch
-    } // str_to_int()
+    class CircuitBreaker
+    {
+      public:
+        std::atomic<size_t> failures;
+        std::atomic<int64_t> retry_at; // steady_clock microseconds
+
+        CircuitBreaker(void):
+          failures(0),
+          retry_at(0)
+        {}
+    };
 
     // ****************************************************************************************************
-    /// @name            configure
+    /// @class         Cache
     ///
-    /// @brief           Configure the connection. The interal configuration must be valid.
+    /// @brief         An optional in-process cache of full-key retrieve() results, in front of the database.
+    ///                Keys are hashed into independently locked shards. A full shard evicts by GreedyDual-Size:
+    ///                the entry with the lowest priority goes, where priority is the shard's inflation at the time the entry
+    ///                was last used plus one over its size. Entries age as evictions raise the inflation, and a large entry
+    ///                ages faster than a small one. Without a byte budget every size counts as one, which is plain LRU.
     ///
-    void configure(void){
-      //
-      // Set the read/write consistencies
-      //
-      auto parse_consistencies = [](std::string str){
-        std::vector<CassConsistency> consistencies;
-        std::stringstream ss(str);
-        std::string element;
-        while(std::getline(ss, element, ','))
+    class Cache
+    {
+      public:
+        typedef enum{
+          CACHE_MISS,
+          CACHE_HIT,
+          CACHE_STALE,    // An expired value that is still served while it is being refreshed.
+          CACHE_REFRESH,  // An expired value that is still served, and should be refreshed.
+          CACHE_NOT_FOUND // A recent retrieve() found no value.
+        } Lookup_t;
+
+      private:
+        class Entry
         {
-          element = trim(element);
-          CassConsistency consistency = element == "ALL"          ? CASS_CONSISTENCY_ALL :
-                                        element == "EACH_QUORUM"  ? CASS_CONSISTENCY_EACH_QUORUM :
-                                        element == "QUORUM"       ? CASS_CONSISTENCY_QUORUM :
-                                        element == "LOCAL_QUORUM" ? CASS_CONSISTENCY_LOCAL_QUORUM :
-                                        element == "ONE"          ? CASS_CONSISTENCY_ONE :
-                                        element == "TWO"          ? CASS_CONSISTENCY_THREE :
-                                        element == "LOCAL_ONE"    ? CASS_CONSISTENCY_LOCAL_ONE :
-                                        element == "ANY"          ? CASS_CONSISTENCY_ANY :
-                                        element == "SERIAL"       ? CASS_CONSISTENCY_SERIAL :
-                                        element == "LOCAL_SERIAL" ? CASS_CONSISTENCY_LOCAL_SERIAL :
-                                                                    CASS_CONSISTENCY_UNKNOWN;
-          if(consistency != CASS_CONSISTENCY_UNKNOWN){
-            consistencies.push_back(consistency);
-          }
-        }
-        if(consistencies.size() == 0){
-          consistencies.push_back(CASS_CONSISTENCY_ANY);
-        }
-        return consistencies;
-      };
-      this->read_consistencies = parse_consistencies(config.at("read_consistencies"));
-      this->write_consistencies = parse_consistencies(config.at("write_consistencies"));
+          public:
+            std::string key;
+            Val_T value;
+            std::tuple<Keys...> keys;
+            std::chrono::steady_clock::time_point expires_at;
+            std::chrono::steady_clock::time_point stale_until; // Served while a refresh is in flight until then.
+            std::chrono::steady_clock::time_point deleted_at;  // When the row's TTL runs out, if it has one.
+            int64_t write_time;
+            bool is_not_found;
+            bool is_dirty;      // Stored locally but still waiting in the backlog.
+            bool is_refreshing; // A refresh was started when the entry was first found stale.
+            size_t size;   // Approximate bytes of memory used, set by push().
+            typename std::multimap<double, Entry*>::iterator position; // In the shard's eviction queue.
+        };
 
-      //
-      // Set the default backlog mode.
-      //
-      int backlog_mode = str_to_int(config.at("default_backlog_mode"), 1);
-      this->default_backlog_mode = backlog_mode == 0 ? DISALLOW_BACKLOG :
-                                   backlog_mode == 2 ? USE_ONLY_BACKLOG :
-                                                       ALLOW_BACKLOG;
+        // ****************************************************************************************************
+        /// @class         Sketch
+        ///
+        /// @brief         A count-min sketch of how often keys are looked up, for TinyLFU admission.
+        ///                The counters are halved every '10 * width' increments, so old popularity fades.
+        ///
+        class Sketch
+        {
+          private:
+            static const size_t depth = 4;
+            std::vector<uint8_t> counters; // 'depth' rows of 'width' counters that saturate at 15.
+            size_t mask;
+            size_t additions;
 
-      //
-      // Retrieve the keys
-      //
-      std::stringstream ss(this->config.at("key_field"));
-      std::string field;
-      while(std::getline(ss, field, ',')){
-        field = trim(field);
-        if(field != ""){
-          keys.push_back(field);
-        }
-      }
+            size_t index(size_t hash, size_t row) const{
+              uint64_t mixed = static_cast<uint64_t>(hash) + (row + 1) * 0x9E3779B97F4A7C15ULL;
+              mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+              mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBULL;
+              return row * (this->mask + 1) + ((mixed ^ (mixed >> 31)) & this->mask);
+            }
 
-      //
-      // Set the log level
-      //
-      int log_level = str_to_int(config.at("client_log_level"), 2);
-      cass_log_set_level(log_level == 0 ? CASS_LOG_DISABLED :
-                         log_level == 1 ? CASS_LOG_CRITICAL :
-                         log_level == 2 ? CASS_LOG_ERROR :
-                         log_level == 3 ? CASS_LOG_WARN :
-                         log_level == 4 ? CASS_LOG_INFO :
-                         log_level == 5 ? CASS_LOG_DEBUG :
-                                          CASS_LOG_TRACE);
+          public:
+            Sketch(void):
+              mask(0),
+              additions(0)
+            {}
 
-      //
-      // Create the cluster profile once.
-      //
-      this->cluster = cass_cluster_new();
-      std::string username = config.at("username");
-      std::string password = config.at("password");
-      if(username != "" or password != ""){
-        cass_cluster_set_credentials(this->cluster, username.c_str(), password.c_str());
-      }
-      cass_cluster_set_contact_points(this->cluster, config.at("hosts").c_str());
-      cass_cluster_set_port(this->cluster, str_to_int(config.at("port"), 9042));
-      cass_cluster_set_num_threads_io(this->cluster, str_to_int(config.at("client_io_threads"), 2));
-      cass_cluster_set_queue_size_io(this->cluster, str_to_int(config.at("client_queue_size"), 8192));
-      cass_cluster_set_core_connections_per_host(this->cluster, str_to_int(config.at("client_server_connects_per_thread"), 1));
-      cass_cluster_set_max_connections_per_host(this->cluster, str_to_int(config.at("client_max_connects_per_thread"), 2));
-      cass_cluster_set_max_concurrent_creation(this->cluster, str_to_int(config.at("client_max_conc_connect_creation"), 1));
-      cass_cluster_set_max_concurrent_requests_threshold(this->cluster, str_to_int(config.at("client_max_concurrent_requests"), 100));
+            // ****************************************************************************************************
+            /// @param           width        Counters per row, rounded up to a power of two. '0' disables the sketch.
+            ///
+            void resize(size_t width){
+              size_t rounded = 1;
+              while(rounded < width){
+                rounded <<= 1;
+              }
+              this->counters.assign(width != 0 ? depth * rounded : 0, 0);
+              this->mask = rounded - 1;
+              this->additions = 0;
+            }
 
-      //
-      // Setup SSL (https://docs.datastax.com/en/developer/cpp-driver/2.0/topics/security/ssl/)
-      //
-      std::string server_trusted_cert = config.count("server_trusted_cert") ? config.at("server_trusted_cert") : "";
-      std::string client_ssl_cert = config.count("client_ssl_cert") ? config.at("client_ssl_cert") : "";
-      std::string client_ssl_key = config.count("client_ssl_key") ? config.at("client_ssl_key") : "";
+            void increment(size_t hash){
+              if(this->counters.empty()){
+                return;
+              }
+              for(size_t row = 0; row < depth; row++){
+                uint8_t& counter = this->counters[this->index(hash, row)];
+                counter += counter < 15 ? 1 : 0;
+              }
+              if(++this->additions >= 10 * (this->mask + 1)){
+                for(uint8_t& counter : this->counters){
+                  counter >>= 1;
+                }
+                this->additions /= 2;
+              }
+            }
 
-      if(server_trusted_cert != "" or
-         (client_ssl_cert != "" and client_ssl_key != "")){
-        CassSsl* ssl = cass_ssl_new();
+            uint8_t estimate(size_t hash) const{
+              uint8_t frequency = 15;
+              for(size_t row = 0; row < depth and not this->counters.empty(); row++){
+                frequency = std::min(frequency, this->counters[this->index(hash, row)]);
+              }
+              return frequency;
+            }
+        };
 
-        //
-        // Server Certificate
-        //
-        if(server_trusted_cert != ""){
-          auto load_trusted_cert_file = [](const char* file, CassSsl* ssl) -> CassError{
-            std::ifstream input_file_stream(file);
-            std::stringstream string_buffer;
-            string_buffer << input_file_stream.rdbuf();
-            std::string certificate = string_buffer.str();
-            return cass_ssl_add_trusted_cert(ssl, certificate.c_str());
-          };
-          std::stringstream ss(server_trusted_cert);
-          std::string cert;
-          while(std::getline(ss, cert, ','))
-          {
-            cert = trim(cert);
-            if(cert != ""){
-              load_trusted_cert_file(cert.c_str(), ssl);
+        class Shard
+        {
+          public:
+            std::mutex mutex;
+            std::unordered_map<std::string, Entry> entries;
+            std::multimap<double, Entry*> queue; // Lowest priority, i.e. next to be evicted, first.
+            double inflation;         // The priority of the last evicted entry.
+            uint64_t version;         // Bumped by every erase(), so a read that started before a store() isn't cached.
+            size_t bytes;             // Sum of the entries' sizes.
+            Sketch sketch;            // Lookups of each key, when admission is filtered.
+
+            Shard(void):
+              inflation(0),
+              version(0),
+              bytes(0)
+            {}
+        };
+
+        std::vector<std::unique_ptr<Shard>> shards;
+        const size_t max_entries_per_shard;
+        const size_t max_bytes_per_shard;
+        const std::chrono::milliseconds ttl;
+        const std::chrono::milliseconds degraded_ttl;
+        const std::chrono::milliseconds not_found_ttl;
+        const std::chrono::milliseconds max_stale;
+        const bool is_keeping_expired;
+        const bool is_filtering_admission;
+
+        Shard& shard_for(const std::string& key){
+          return *this->shards.at(std::hash<std::string>()(key) % this->shards.size());
+        }
+
+        // ****************************************************************************************************
+        /// @name            put
+        ///
+        /// @brief           Add or replace an entry read from the database, unless the shard has been written to since
+        ///                  'version', or the existing entry is dirty or from a newer write.
+        ///
+        void put(Entry&& entry, uint64_t version){
+          Shard& shard = this->shard_for(entry.key);
+          std::lock_guard<std::mutex> lock(shard.mutex);
+          if(shard.version != version){
+            return;
+          }
+          auto found = shard.entries.find(entry.key);
+          bool is_new = found == shard.entries.end();
+          if(not is_new){
+            if(found->second.is_dirty or (entry.write_time != 0 and found->second.write_time > entry.write_time)){
+              return;
             }
+            this->remove(shard, found->second);
           }
-
-          int verify_mode = str_to_int(config.at("server_verify_mode"), 1);
-          cass_ssl_set_verify_flags(ssl, verify_mode == 0 ? CASS_SSL_VERIFY_NONE :
-                                         verify_mode == 2 ? CASS_SSL_VERIFY_PEER_CERT | CASS_SSL_VERIFY_PEER_IDENTITY :
-                                         verify_mode == 3 ? CASS_SSL_VERIFY_PEER_CERT | CASS_SSL_VERIFY_PEER_IDENTITY_DNS :
-                                                            CASS_SSL_VERIFY_PEER_CERT);
+          this->push(shard, std::move(entry), is_new and this->is_filtering_admission);
         }
 
-        //
-        // Client Certificate (Authentication)
-        //
-        if(client_ssl_cert != "" and client_ssl_key != ""){
-          auto load_ssl_cert = [](const char* file, CassSsl* ssl) -> CassError{
-            std::ifstream input_file_stream(file);
-            std::stringstream string_buffer;
-            string_buffer << input_file_stream.rdbuf();
-            std::string certificate = string_buffer.str();
-            return cass_ssl_set_cert(ssl, certificate.c_str());
-          };
-          load_ssl_cert(client_ssl_cert.c_str(), ssl);
-          auto load_private_key = [](const char* file, CassSsl* ssl, const char* key_password) -> CassError{
-            std::ifstream input_file_stream(file);
-            std::stringstream string_buffer;
-            string_buffer << input_file_stream.rdbuf();
-            std::string certificate = string_buffer.str();
-            return cass_ssl_set_private_key(ssl, certificate.c_str(), key_password);
-          };
-          load_private_key(client_ssl_key.c_str(), ssl,
-              config.count("client_key_password") and config.at("client_key_password") != "" ?
-                        config.at("client_key_password").c_str() : nullptr);
+        // ****************************************************************************************************
+        /// @name            push
+        ///
+        /// @brief           Add an entry to a locked shard, evicting the lowest priority entries while it is full.
+        ///                  An entry bigger than an eighth of the shard's byte budget isn't cached at all.
+        ///
+        /// @param           is_filtered  'true' to reject the entry if the shard is full and its key has been looked up
+        ///                               no more often than the key that would be evicted first.
+        ///
+        void push(Shard& shard, Entry&& entry, bool is_filtered){
+          entry.size = sizeof(typename decltype(shard.entries)::value_type) + sizeof(typename decltype(shard.queue)::value_type) +
+                       2 * entry.key.size() + heap_size(entry.value) + 4 * sizeof(void*);
+          if(this->max_bytes_per_shard != 0 and entry.size > this->max_bytes_per_shard / 8){
+            return;
+          }
+          if(is_filtered and not shard.queue.empty() and
+             (shard.entries.size() >= this->max_entries_per_shard or
+              (this->max_bytes_per_shard != 0 and shard.bytes + entry.size > this->max_bytes_per_shard)) and
+             shard.sketch.estimate(std::hash<std::string>()(entry.key)) <=
+             shard.sketch.estimate(std::hash<std::string>()(shard.queue.begin()->second->key))){
+            return; // A one-off read, e.g. from a scan, doesn't displace a more popular key.
+          }
+          Entry& pushed = shard.entries.emplace(entry.key, std::move(entry)).first->second;
+          pushed.position = shard.queue.emplace(this->priority(shard, pushed), &pushed);
+          shard.bytes += pushed.size;
+          while(shard.entries.size() > this->max_entries_per_shard or
+                (this->max_bytes_per_shard != 0 and shard.bytes > this->max_bytes_per_shard)){
+            shard.inflation = shard.queue.begin()->first;
+            this->remove(shard, *shard.queue.begin()->second);
+          }
         }
 
-        cass_cluster_set_ssl(this->cluster, ssl);
-        cass_ssl_free(ssl);
-      }
-    } // configure()
+        // ****************************************************************************************************
+        /// @name            priority
+        ///
+        /// @brief           The eviction priority of an entry that is being used now.
+        ///
+        double priority(const Shard& shard, const Entry& entry) const{
+          return shard.inflation + 1.0 / (this->max_bytes_per_shard != 0 ? entry.size : 1);
+        }
 
-    // ****************************************************************************************************
-    /// @name            run_backlog_thread
-    ///
-    /// @brief           Run the backlog thread.
-    ///
-    void run_backlog_thread(void){
-      //
-      // Start the backlog thread
-      //
-      std::atomic<bool> are_pointers_setup(false);
+        // ****************************************************************************************************
+        /// @name            remove
+        ///
+        /// @brief           Drop an entry from a locked shard.
+        ///
+        void remove(Shard& shard, Entry& entry){
+          shard.bytes -= entry.size;
+          shard.queue.erase(entry.position);
+          shard.entries.erase(shard.entries.find(entry.key));
+        }
 
-      // *****************************************************************************
-      /// @name           initialize
-      ///
-      /// @brief          Initialize the connection given a valid CassCluster* already setup.
-      ///
-      auto initialize = [&](void){
-        this->session = cass_session_new();
-        if(this->session != nullptr){
-          CassFuture* connect_future = cass_session_connect(this->session, cluster);
-          if(connect_future != nullptr){
-            cass_future_wait_timed(connect_future, 4000000L); // Wait up to 4s
-            if (cass_future_error_code(connect_future) == CASS_OK) {
+      public:
+        // ****************************************************************************************************
+        /// @param           max_entries  The most entries to cache, or '0' for no limit.
+        /// @param           max_bytes    The most memory to use for entries, or '0' for no limit.
+        /// @param           degraded_ttl The lifetime, instead of 'ttl', of a read answered by a fallback consistency level.
+        /// @param           max_stale    How long past 'ttl' an entry may still be served while it is refreshed.
+        /// @param           keep_expired 'true' to keep expired values until evicted, for find_last_known().
+        /// @param           filter_admission 'true' to only cache a read value when the shard is full if its key has been
+        ///                  looked up more often than the key it would evict (TinyLFU).
+        ///
+        Cache(size_t max_entries, size_t max_bytes, size_t shard_count, std::chrono::milliseconds ttl, std::chrono::milliseconds degraded_ttl,
+              std::chrono::milliseconds not_found_ttl, std::chrono::milliseconds max_stale, bool keep_expired, bool filter_admission):
+          max_entries_per_shard(max_entries != 0 ? std::max<size_t>(1, max_entries / shard_count) : std::numeric_limits<size_t>::max()),
+          max_bytes_per_shard(max_bytes != 0 ? std::max<size_t>(1, max_bytes / shard_count) : 0),
+          ttl(ttl),
+          degraded_ttl(degraded_ttl),
+          not_found_ttl(not_found_ttl),
+          max_stale(max_stale),
+          is_keeping_expired(keep_expired),
+          is_filtering_admission(filter_admission)
+        {
+          for(size_t ndx = 0; ndx < shard_count; ndx++){
+            this->shards.push_back(std::unique_ptr<Shard>(new Shard()));
+            if(filter_admission){
               //
-              // Build the INSERT prepared statement
+              // Eight counters per row for each entry the shard can hold, so that the many keys seen only once by
+              // a scan rarely share all of their counters with a popular key. With only a byte budget, assume 128 byte entries.
               //
-              {
-                std::string statement = "INSERT INTO " + this->config.at("table") + " (" + this->config.at("key_field") +
-                                        ", " + this->config.at("value_field") + ") VALUES (";
-                for(size_t ndx = 0; ndx < keys.size(); ndx++){
-                  statement += "?,";
-                }
-                statement += "?) USING TTL ?";
+              size_t capacity = std::min<size_t>(this->max_entries_per_shard,
+                                                 this->max_bytes_per_shard != 0 ? this->max_bytes_per_shard / 128 : 1 << 21);
+              this->shards.back()->sketch.resize(8 * std::max<size_t>(16, capacity));
+            }
+          }
+        }
 
-                CassFuture* future = cass_session_prepare(this->session, statement.c_str());
-                if(future != nullptr){
-                  cass_future_wait_timed(future, 2000000L); // Wait up to 2s
-                  if (cass_future_error_code(future) == CASS_OK) {
-                    this->prepared_insert = cass_future_get_prepared(future);
-                  }
-                  else{
-                    //
-                    // Error: Unable to prepare insert statement
-                    //
-                  }
-                  cass_future_free(future);
-                }
-              }
+        // ****************************************************************************************************
+        /// @name            find
+        ///
+        /// @brief           Look up an unexpired entry, marking it as recently used.
+        ///                  An expired value is still found until it is 'max_stale' old, but only the first lookup
+        ///                  is told that it is stale, so that a single refresh is started.
+        ///
+        /// @return          CACHE_HIT with the row copied into 'row', CACHE_STALE or CACHE_REFRESH with the expired row
+        ///                  copied into 'row', CACHE_NOT_FOUND if the key is known to have no value, or CACHE_MISS.
+        ///
+        Lookup_t find(const std::string& key, std::pair<Val_T, std::tuple<Keys...>>* row){
+          Shard& shard = this->shard_for(key);
+          std::lock_guard<std::mutex> lock(shard.mutex);
+          shard.sketch.increment(std::hash<std::string>()(key));
+          auto found = shard.entries.find(key);
+          if(found == shard.entries.end()){
+            return CACHE_MISS;
+          }
+          Entry& entry = found->second;
+          auto now = std::chrono::steady_clock::now();
+          if(entry.deleted_at <= now or (entry.stale_until <= now and not this->is_keeping_expired)){
+            this->remove(shard, entry);
+            return CACHE_MISS;
+          }
+          else if(entry.stale_until <= now){
+            return CACHE_MISS; // Kept only for find_last_known().
+          }
+          shard.queue.erase(entry.position);
+          entry.position = shard.queue.emplace(this->priority(shard, entry), &entry);
+          if(entry.is_not_found){
+            return CACHE_NOT_FOUND;
+          }
+          *row = std::make_pair(entry.value, entry.keys);
+          if(entry.expires_at <= now){
+            if(entry.is_refreshing){
+              return CACHE_STALE;
+            }
+            entry.is_refreshing = true;
+            return CACHE_REFRESH;
+          }
+          return CACHE_HIT;
+        }
 
-              //
-              // Build the SELECT prepared statements
-              //
-              {
-                for(size_t total = 1; total <= keys.size(); total++){
-                  // total == # of keys to move to the WHERE clause.
-                  std::string statement = "SELECT " + this->config.at("value_field");
-                  for(size_t value = total; value < keys.size(); value++){
-                    statement += "," + keys.at(value);
-                  }
-                  statement += " FROM " + this->config.at("table") + " WHERE ";
-                  for(size_t key = 0; key < total; key++){
-                    statement += (key != 0 ? " AND " : "") + keys.at(key) + "=?";
-                  }
+        // ****************************************************************************************************
+        /// @name            find_last_known
+        ///
+        /// @brief           Look up the last value cached for the key, even if it has expired, as long as its row hasn't.
+        ///                  The entry is not marked as recently used.
+        ///
+        /// @return          'true' with the row copied into 'row', or 'false' if there is no such value.
+        ///
+        bool find_last_known(const std::string& key, std::pair<Val_T, std::tuple<Keys...>>* row){
+          Shard& shard = this->shard_for(key);
+          std::lock_guard<std::mutex> lock(shard.mutex);
+          auto found = shard.entries.find(key);
+          if(found == shard.entries.end() or found->second.is_not_found or
+             found->second.deleted_at <= std::chrono::steady_clock::now()){
+            return false;
+          }
+          *row = std::make_pair(found->second.value, found->second.keys);
+          return true;
+        }
 
-                  CassFuture* future = cass_session_prepare(this->session, statement.c_str());
-                  if(future != nullptr){
-                    cass_future_wait_timed(future, 2000000L); // Wait up to 2s
-                    if (cass_future_error_code(future) == CASS_OK) {
-                      this->prepared_selects[total] = cass_future_get_prepared(future);
-                    }
-                    else{
-                      //
-                      // Error: Unable to prepare select statement
-                      //
-                    }
-                    cass_future_free(future);
-                  }
-                }
+        // ****************************************************************************************************
+        /// @name            snapshot
+        ///
+        /// @brief           List the keys of the values that find() would return, highest priority first within each shard.
+        ///
+        std::vector<std::tuple<Keys...>> snapshot(void){
+          std::vector<std::tuple<Keys...>> keys;
+          auto now = std::chrono::steady_clock::now();
+          for(auto& shard : this->shards){
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            for(auto queued = shard->queue.rbegin(); queued != shard->queue.rend(); queued++){
+              const Entry& entry = *queued->second;
+              if(not entry.is_not_found and entry.stale_until > now){
+                keys.push_back(entry.keys);
               }
             }
-            else{
-              //
-              // Error: Unable to connect
-              //
-            }
-            cass_future_free(connect_future);
+          }
+          return keys;
+        }
 
-            if(this->session != nullptr and this->prepared_insert != nullptr and this->prepared_selects.size() != 0){
-              this->is_initialized = true;
-            }
-            else{
-              if(this->prepared_insert != nullptr){
-                cass_prepared_free(this->prepared_insert);
-                this->prepared_insert = nullptr;
-              }
-              for(const auto& pair : this->prepared_selects){
-                if(pair.second != nullptr){
-                  cass_prepared_free(pair.second);
-                }
-              }
-              this->prepared_selects.clear();
-            }
+        // ****************************************************************************************************
+        /// @name            version
+        ///
+        /// @brief           Get the version to pass to insert() once the database read that follows a miss completes.
+        ///
+        uint64_t version(const std::string& key){
+          Shard& shard = this->shard_for(key);
+          std::lock_guard<std::mutex> lock(shard.mutex);
+          return shard.version;
+        }
+
+        // ****************************************************************************************************
+        /// @name            insert
+        ///
+        /// @brief           Cache a value read from the database, unless the shard has been written to since 'version'.
+        ///                  The entry, even when stale, never outlives the row's remaining server-side TTL, if it has one.
+        ///                  An entry is never replaced by an older write.
+        ///
+        /// @param           seconds_ttl  The row's TTL() when it was read, or '0' if unknown or none.
+        /// @param           write_time   The row's WRITETIME() in microseconds since the epoch, or '0' if unknown.
+        /// @param           is_degraded  'true' if the read was answered by a fallback consistency level.
+        ///
+        void insert(const std::string& key, uint64_t version, const Val_T& value, const std::tuple<Keys...>& keys,
+                    int32_t seconds_ttl = 0, int64_t write_time = 0, bool is_degraded = false){
+          auto now = std::chrono::steady_clock::now();
+          auto expires_at = now + (is_degraded ? this->degraded_ttl : this->ttl);
+          auto stale_until = expires_at + this->max_stale;
+          auto deleted_at = std::chrono::steady_clock::time_point::max();
+          if(seconds_ttl > 0){
+            //
+            // TTL() is rounded to whole seconds, so allow for up to a second having already gone by.
+            //
+            deleted_at = now + std::chrono::milliseconds(1000L * (seconds_ttl - 1));
+            expires_at = std::min(expires_at, deleted_at);
+            stale_until = std::min(stale_until, deleted_at);
           }
-          if(not this->is_initialized and this->session != nullptr){
-            cass_session_free(this->session);
-            this->session = nullptr;
+          if(expires_at > now){
+            this->put(Entry{key, value, keys, expires_at, stale_until, deleted_at, write_time, false, false, false, 0, {}}, version);
           }
-        }        
-      };
+        }
 
-      // *****************************************************************************
-      /// @name           backlog_thread
-      ///
-      /// @brief          The backlog thread handles initializing the connection and manages the backlog queue.
-      ///
-      this->backlog_thread = std::thread([&, initialize](void){
-        //
-        // Setup the pointers back to the master thread.
-        // The backlog thread will never close until the master thread tells it to close.
-        // At that point it can terminate after the master thread, so it must control the data to prevent seg faults.
-        //
-        std::atomic<bool> do_terminate_thread(false);
-        std::mutex backlog_mutex;
-        std::shared_ptr<std::atomic<bool>> is_processing_backlog = this->is_processing_backlog_ptr;
-        std::deque<std::tuple<std::tuple<Keys...>,Val_T,int32_t,int64_t>> backlog_queue;
+        // ****************************************************************************************************
+        /// @name            insert_not_found
+        ///
+        /// @brief           Remember for a short while that the key has no value, unless the shard has been written
+        ///                  to since 'version'.
+        ///
+        void insert_not_found(const std::string& key, uint64_t version, const std::tuple<Keys...>& keys, bool is_degraded = false){
+          auto lifetime = is_degraded ? std::min(this->not_found_ttl, this->degraded_ttl) : this->not_found_ttl;
+          if(lifetime.count() > 0){
+            auto expires_at = std::chrono::steady_clock::now() + lifetime;
+            this->put(Entry{key, Val_T{}, keys, expires_at, expires_at, expires_at, 0, true, false, false, 0, {}}, version);
+          }
+        }
 
-        this->do_terminate_thread_ptr = &do_terminate_thread;
-        this->backlog_mutex_ptr = &backlog_mutex;
-        this->backlog_queue_ptr = &backlog_queue;
+        // ****************************************************************************************************
+        /// @name            write
+        ///
+        /// @brief           Cache a value written by this client, replacing whatever was cached and invalidating reads
+        ///                  of the key that are already in flight. A clean entry lives no longer than the 'seconds_ttl'
+        ///                  it was stored with. A dirty entry is kept until the backlog stores it or it is evicted.
+        ///
+        /// @param           seconds_ttl  The TTL the value was stored with, or '0' for none.
+        /// @param           write_time   The write's timestamp in microseconds since the epoch.
+        /// @param           is_dirty     'true' if the value is waiting in the backlog rather than in the database.
+        ///
+        void write(const std::string& key, const Val_T& value, const std::tuple<Keys...>& keys, int32_t seconds_ttl, int64_t write_time, bool is_dirty){
+          auto now = std::chrono::steady_clock::now();
+          auto expires_at = is_dirty ? std::chrono::steady_clock::time_point::max() : now + this->ttl;
+          auto stale_until = is_dirty ? expires_at : expires_at + this->max_stale;
+          auto deleted_at = std::chrono::steady_clock::time_point::max();
+          if(seconds_ttl > 0){
+            deleted_at = now + std::chrono::seconds(seconds_ttl);
+            expires_at = std::min(expires_at, deleted_at);
+            stale_until = std::min(stale_until, deleted_at);
+          }
 
-        //
-        // This tells the master thread that we are processing.
-        // It will not go out of scope until we set processing to 'false', allowing both threads to poll is_initialized without locking.
-        //
-        *is_processing_backlog = true;
+          Shard& shard = this->shard_for(key);
+          std::lock_guard<std::mutex> lock(shard.mutex);
+          shard.version++;
+          auto found = shard.entries.find(key);
+          if(found != shard.entries.end()){
+            if(not found->second.is_dirty and found->second.write_time > write_time){
+              return; // A newer value has already been read back from the database.
+            }
+            this->remove(shard, found->second);
+          }
+          if(expires_at > now){
+            this->push(shard, Entry{key, value, keys, expires_at, stale_until, deleted_at, write_time, false, is_dirty, false, 0, {}}, false);
+          }
+        }
 
-        //
-        // Notify the master thread that the pointers are setup and it is okay for 'are_pointers_setup' to go out-of-scope.
-        //
-        are_pointers_setup = true;
+        // ****************************************************************************************************
+        /// @name            erase
+        ///
+        /// @brief           Drop any entry for the key, and invalidate reads of it that are already in flight.
+        ///
+        void erase(const std::string& key){
+          Shard& shard = this->shard_for(key);
+          std::lock_guard<std::mutex> lock(shard.mutex);
+          shard.version++;
+          auto found = shard.entries.find(key);
+          if(found != shard.entries.end()){
+            this->remove(shard, found->second);
+          }
+        }
+    };
 
-        //
-        // Wait for the thread to initialize.
-        // During this period, the master thread cannot destruct since we are still accessing "is_initialized"
-        // "do_terminate_thread" must be set first.
-        // Once initialization takes place, we never need to access it again.
-        //
-        initialize();
-        while(not do_terminate_thread and not this->is_initialized){
-          try{
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-            initialize();
+    // ****************************************************************************************************
+    /// @class         Flight
+    ///
+    /// @brief         A retrieve() that identical retrieve() calls may join instead of sending their own SELECT.
+    ///
+    class Flight
+    {
+      public:
+        std::chrono::steady_clock::time_point deadline; // When the leading request gives up.
+        std::vector<Callback> waiters;                   // The callbacks of the calls that joined it.
+    };
+
+    // ****************************************************************************************************
+    /// @class         Inbox
+    ///
+    /// @brief         Where store() leaves writes for the backlog, without taking a lock: a multi-producer,
+    ///                single-consumer queue (Vyukov's intrusive MPSC queue).
+    ///                A producer links its node in with a single atomic exchange, so producers never wait on each other.
+    ///                The consumer is whoever holds 'backlog_mutex'. A write whose producer has exchanged but not yet
+    ///                linked its node is picked up by the next pop() after it is linked.
+    ///
+    class Inbox
+    {
+      private:
+        class Node
+        {
+          public:
+            std::atomic<Node*> next;
+            std::tuple<std::tuple<Keys...>,Val_T,int32_t,int64_t> item;
+
+            Node(void): next(nullptr) {}
+        };
+
+        std::atomic<Node*> head; // The node pushed last.
+        Node* tail;              // The node popped last, whose item is gone, or the initial stub.
+
+      public:
+        Inbox(void):
+          head(new Node()),
+          tail(head.load())
+        {}
+
+        ~Inbox(void){
+          std::tuple<std::tuple<Keys...>,Val_T,int32_t,int64_t> item;
+          while(this->pop(&item)){}
+          delete this->tail;
+        }
+
+        void push(std::tuple<std::tuple<Keys...>,Val_T,int32_t,int64_t>&& item){
+          Node* node = new Node();
+          node->item = std::move(item);
+          Node* previous = this->head.exchange(node, std::memory_order_acq_rel);
+          previous->next.store(node, std::memory_order_release);
+        }
+
+        // ****************************************************************************************************
+        /// @name            pop
+        ///
+        /// @brief           Take the oldest write. Only one thread at a time may call this.
+        ///
+        /// @return          'false' if there is none.
+        ///
+        bool pop(std::tuple<std::tuple<Keys...>,Val_T,int32_t,int64_t>* item){
+          Node* next = this->tail->next.load(std::memory_order_acquire);
+          if(next == nullptr){
+            return false;
           }
-          catch(...){}
+          *item = std::move(next->item);
+          delete this->tail;
+          this->tail = next;
+          return true;
         }
-        *is_processing_backlog = false;
-        while(not do_terminate_thread){
-          try{
-            std::this_thread::sleep_for(std::chrono::seconds(2));
+    };
 
-            //
-            // Get all the entries in the backlog so we can attempt to send them.
-            //
-            std::deque<std::tuple<std::tuple<Keys...>,Val_T,int32_t,int64_t>> backlog;
-            {
-              std::lock_guard<std::mutex> lock( backlog_mutex );
-              backlog = backlog_queue;
-              backlog_queue.clear();
-              *is_processing_backlog = backlog.size() > 0 and not do_terminate_thread;
-            }
+    // ****************************************************************************************************
+    /// @class         Backlog
+    ///
+    /// @brief         The store() requests waiting for the backlog thread, oldest first.
+    ///                Without a journal directory they are only kept in memory. With one, they are appended to a journal
+    ///                of memory-mapped segment files instead, so they survive a restart and aren't limited by memory.
+    ///                Each record is checksummed, and reading a segment stops at the first record that doesn't match,
+    ///                such as one torn by a crash. A segment's header records how much of it has been stored, and a
+    ///                segment is deleted once all of it has been.
+    ///                When coalescing, only the newest write of each key is kept: a queued write is replaced in place
+    ///                by a newer one, and a journaled write that a newer one superseded is skipped when it is read back.
+    ///                Keys are indexed by their keyToBytes() form.
+    ///                The caller serializes access to it with 'backlog_mutex'.
+    ///
+    class Backlog
+    {
+      public:
+        typedef std::tuple<std::tuple<Keys...>,Val_T,int32_t,int64_t> Item;
 
-            //
-            // Attempt to process the backlog.
-            //
-            if(*is_processing_backlog){
-              std::vector<std::tuple<std::tuple<Keys...>,Val_T,int32_t,int64_t>> unprocessed;
-              for(auto& request : backlog){
-                if(not do_terminate_thread){
-                  //
-                  // Proxy the call to store().
-                  // We need to unpack the tuple<Keys...> into paramters to store().
-                  //
-                  ValuStor::Result result = this->call_store(std::get<0>(request), // tuple<Keys...>
-                                                             std::get<1>(request), // Val_T
-                                                             std::get<2>(request), // TTL
-                                                             DISALLOW_BACKLOG,     // InsertMode
-                                                             std::get<3>(request), // insert time
-                                                             typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{});
-                  if(not result){
-                    unprocessed.push_back(request);
-                  }
-                }
+      private:
+        class Segment
+        {
+          public:
+            uint64_t number;
+            char* memory;
+            size_t size;
+            size_t end;      // Where the next record is appended, after the last valid record.
+        };
+
+        static const uint64_t magic = 0x56616c75426c6f67ULL; // "ValuBlog"
+        static const size_t header_bytes = 64;               // magic, offset of the first record not yet stored
+        static const size_t record_header_bytes = 8;         // payload size, CRC-32 of the payload
+        static const size_t max_records_per_take = 1024;
+
+        std::deque<Item> queue; // Used without a journal.
+        const bool is_coalescing;
+        std::unordered_map<std::string, uint64_t> positions; // Key to its item's position in 'queue', plus 'front_position'.
+        uint64_t front_position;
+        std::unordered_map<std::string, std::pair<int64_t, size_t>> newest; // Key to the newest timestamp and number of records journaled.
+        std::string directory;
+        size_t segment_bytes;
+        int lock_fd;
+        std::deque<Segment> segments;
+        uint64_t next_number;   // Of the next segment file created.
+        bool is_appending;      // 'true' once this run has created a segment to append to.
+        size_t read_segment;    // The index and offset in 'segments' up to which records were taken.
+        size_t read_offset;
+        size_t pending;         // Journaled records not yet taken.
+
+        static uint32_t crc32(const char* data, size_t length){
+          static const std::vector<uint32_t> table = [](){
+            std::vector<uint32_t> table(256);
+            for(uint32_t n = 0; n < 256; n++){
+              uint32_t c = n;
+              for(int k = 0; k < 8; k++){
+                c = (c & 1) != 0 ? 0xedb88320U ^ (c >> 1) : c >> 1;
               }
+              table[n] = c;
+            }
+            return table;
+          }();
+          uint32_t crc = 0xffffffffU;
+          for(size_t ndx = 0; ndx < length; ndx++){
+            crc = table[(crc ^ static_cast<uint8_t>(data[ndx])) & 0xff] ^ (crc >> 8);
+          }
+          return crc ^ 0xffffffffU;
+        }
 
-              //
-              // Reinsert the failed requests back into the front of the queue.
-              //
-              if(unprocessed.size() != 0){
-                std::lock_guard<std::mutex> lock( backlog_mutex );
-                if(not do_terminate_thread){
-                  backlog_queue.insert(backlog_queue.begin(), unprocessed.begin(), unprocessed.end());
+        static uint64_t& consumed(Segment& segment){
+          return reinterpret_cast<uint64_t*>(segment.memory)[1];
+        }
+
+        std::string filename(uint64_t number) const{
+          std::ostringstream name;
+          name << this->directory << "/backlog." << std::setw(16) << std::setfill('0') << number << ".journal";
+          return name.str();
+        }
+
+        // ****************************************************************************************************
+        /// @name            record_size
+        ///
+        /// @brief           The size of the valid record at the offset, including its header.
+        ///
+        /// @return          '0' at the end of the segment's records.
+        ///
+        static size_t record_size(const Segment& segment, size_t offset){
+          uint32_t payload_size, checksum;
+          if(segment.size - offset < record_header_bytes){
+            return 0;
+          }
+          std::memcpy(&payload_size, segment.memory + offset, sizeof(payload_size));
+          std::memcpy(&checksum, segment.memory + offset + sizeof(payload_size), sizeof(checksum));
+          if(payload_size == 0 or payload_size > segment.size - offset - record_header_bytes or
+             crc32(segment.memory + offset + record_header_bytes, payload_size) != checksum){
+            return 0;
+          }
+          return record_header_bytes + payload_size;
+        }
+
+        static std::string payload(const Segment& segment, size_t offset){
+          return std::string(segment.memory + offset + record_header_bytes, record_size(segment, offset) - record_header_bytes);
+        }
+
+        // ****************************************************************************************************
+        /// @name            decode
+        ///
+        /// @brief           Read back a record written by push_back().
+        ///
+        /// @param           key_size     Set to the length of the key at the start of the payload.
+        ///
+        /// @return          'false' if the payload can't be decoded, e.g. because the key or value types changed.
+        ///
+        static bool decode(const std::string& payload, Item* item, size_t* key_size){
+          size_t offset = 0;
+          bool is_valid = bytesToKey(payload, &offset, &std::get<0>(*item), typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{});
+          *key_size = offset;
+          return is_valid and deserialize(payload, &offset, &std::get<1>(*item)) and deserialize(payload, &offset, &std::get<2>(*item)) and
+                 deserialize(payload, &offset, &std::get<3>(*item));
+        }
+
+        // ****************************************************************************************************
+        /// @name            is_superseded
+        ///
+        /// @return          'true' if a newer record of the key is already journaled, so this one need not be.
+        ///
+        bool is_superseded(const std::string& key, int64_t timestamp) const{
+          auto found = this->newest.find(key);
+          return found != this->newest.end() and timestamp < found->second.first;
+        }
+
+        // ****************************************************************************************************
+        /// @name            count
+        ///
+        /// @brief           Count a journaled record in the coalescing index.
+        ///                  Superseded records stay counted until they are read back.
+        ///
+        void count(const std::string& key, int64_t timestamp){
+          auto& newest = this->newest[key];
+          newest.first = newest.second != 0 ? std::max(newest.first, timestamp) : timestamp;
+          newest.second++;
+        }
+
+        // ****************************************************************************************************
+        /// @name            replace
+        ///
+        /// @brief           Coalesce a write with the one already queued in memory for the key, keeping the newer.
+        ///                  Of two with the same timestamp, the one queued later is kept.
+        ///
+        /// @param           is_requeued  'true' if the write was queued before the one queued now.
+        ///
+        /// @return          'true' if the key was already queued, so the write needs no place of its own.
+        ///
+        bool replace(const std::string& key, Item& item, bool is_requeued = false){
+          auto found = this->positions.find(key);
+          if(found == this->positions.end()){
+            return false;
+          }
+          Item& queued = this->queue.at(found->second - this->front_position);
+          if(std::get<3>(queued) < std::get<3>(item) or (std::get<3>(queued) == std::get<3>(item) and not is_requeued)){
+            queued = std::move(item);
+          }
+          return true;
+        }
+
+        void enqueue(const std::string& key, Item&& item){
+          if(this->is_coalescing){
+            this->positions[key] = this->front_position + this->queue.size();
+          }
+          this->queue.push_back(std::move(item));
+        }
+
+        void unmap(Segment& segment){
+          #if defined(__unix__)
+          msync(segment.memory, segment.size, MS_SYNC);
+          munmap(segment.memory, segment.size);
+          #endif
+        }
+
+        // ****************************************************************************************************
+        /// @name            open_segment
+        ///
+        /// @brief           Map an existing segment file, or create one of at least 'size' bytes if 'size' isn't '0'.
+        ///                  A new file's blocks are allocated up front, since writing to a page of a sparse file on a full
+        ///                  disk would raise SIGBUS. If they can't be, the file is removed again.
+        ///
+        /// @return          'false' on failure.
+        ///
+        bool open_segment(uint64_t number, size_t size, Segment* segment){
+          #if defined(__unix__)
+          const bool is_new = size != 0;
+          int fd = open(this->filename(number).c_str(), O_RDWR | (is_new ? O_CREAT | O_EXCL : 0), 0600);
+          if(fd < 0){
+            return false;
+          }
+          struct stat status;
+          bool is_valid = is_new ? posix_fallocate(fd, 0, size) == 0 :
+                                   fstat(fd, &status) == 0 and static_cast<size_t>(status.st_size) > header_bytes;
+          size = is_new ? size : is_valid ? static_cast<size_t>(status.st_size) : 0;
+          void* memory = is_valid ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+          ::close(fd);
+          if(memory == MAP_FAILED){
+            if(is_new){
+              unlink(this->filename(number).c_str());
+            }
+            return false;
+          }
+          segment->number = number;
+          segment->memory = static_cast<char*>(memory);
+          segment->size = size;
+          segment->end = header_bytes;
+          uint64_t* header = reinterpret_cast<uint64_t*>(memory);
+          if(header[0] == 0){
+            header[0] = magic;
+            header[1] = header_bytes;
+          }
+          if(header[0] != magic or header[1] < header_bytes or header[1] > size){
+            munmap(memory, size);
+            return false;
+          }
+          return true;
+          #else
+          (void)number; (void)size; (void)segment;
+          return false;
+          #endif
+        }
+
+        // ****************************************************************************************************
+        /// @name            recover
+        ///
+        /// @brief           Map the segments left by an earlier run and count the records that weren't stored yet.
+        ///
+        void recover(void){
+          #if defined(__unix__)
+          std::vector<uint64_t> numbers;
+          DIR* dir = opendir(this->directory.c_str());
+          if(dir != nullptr){
+            while(struct dirent* entry = readdir(dir)){
+              unsigned long long number;
+              char suffix[16];
+              if(std::sscanf(entry->d_name, "backlog.%16llu.%15s", &number, suffix) == 2 and std::string(suffix) == "journal"){
+                numbers.push_back(number);
+              }
+            }
+            closedir(dir);
+          }
+          std::sort(numbers.begin(), numbers.end());
+          this->next_number = numbers.size() != 0 ? numbers.back() + 1 : 1;
+          for(uint64_t number : numbers){
+            Segment segment;
+            if(not this->open_segment(number, 0, &segment)){
+              continue; // Not a journal segment, or damaged beyond use. It is left for inspection.
+            }
+            size_t records = 0;
+            for(segment.end = consumed(segment); size_t size = record_size(segment, segment.end); segment.end += size){
+              if(this->is_coalescing){
+                std::string record = payload(segment, segment.end);
+                Item item;
+                size_t key_size;
+                if(decode(record, &item, &key_size)){
+                  this->count(record.substr(0, key_size), std::get<3>(item));
                 }
               }
+              records++;
+            }
+            if(records == 0){
+              this->unmap(segment);
+              unlink(this->filename(number).c_str());
+              continue;
+            }
+            this->pending += records;
+            this->segments.push_back(segment);
+          }
+          if(this->segments.size() != 0){
+            this->read_offset = consumed(this->segments.front());
+          }
+          #endif
+        }
+
+      public:
+        // ****************************************************************************************************
+        /// @name            constructor
+        ///
+        /// @brief           Create the backlog, recovering any journaled records not yet stored.
+        ///                  If the journal directory can't be used, e.g. because another process holds it,
+        ///                  the backlog is only kept in memory.
+        ///
+        /// @param           directory       The journal directory, or "" for none. It is created if missing.
+        /// @param           segment_bytes   The size of each segment file.
+        /// @param           is_coalescing   'true' to keep only the newest write of each key.
+        ///
+        Backlog(const std::string& directory, size_t segment_bytes, bool is_coalescing):
+          is_coalescing(is_coalescing),
+          front_position(0),
+          segment_bytes(std::max(segment_bytes, header_bytes + record_header_bytes)),
+          lock_fd(-1),
+          next_number(1),
+          is_appending(false),
+          read_segment(0),
+          read_offset(header_bytes),
+          pending(0)
+        {
+          #if defined(__unix__)
+          if(directory != ""){
+            mkdir(directory.c_str(), 0700);
+            this->lock_fd = open((directory + "/backlog.lock").c_str(), O_RDWR | O_CREAT, 0600);
+            if(this->lock_fd >= 0 and flock(this->lock_fd, LOCK_EX | LOCK_NB) == 0){
+              this->directory = directory;
+              this->recover();
+            }
+            else if(this->lock_fd >= 0){
+              ::close(this->lock_fd);
+              this->lock_fd = -1;
             }
+          }
+          #else
+          (void)directory;
+          #endif
+        }
+
+        ~Backlog(void){
+          this->close();
+        }
+
+        bool is_journaled(void) const{
+          return this->directory != "";
+        }
+
+        // ****************************************************************************************************
+        /// @name            size
+        ///
+        /// @return          The number of records waiting to be taken.
+        ///
+        size_t size(void) const{
+          return this->queue.size() + this->pending;
+        }
+
+        // ****************************************************************************************************
+        /// @name            push_back
+        ///
+        /// @brief           Queue a record. If it can't be journaled, e.g. because the disk is full, it is kept in memory.
+        ///
+        void push_back(Item&& item){
+          std::string key = this->is_coalescing or this->is_journaled() ?
+                            keyToBytes(std::get<0>(item), std::tuple_size<std::tuple<Keys...>>{},
+                                       typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{}) : "";
+          if(this->is_coalescing and this->replace(key, item)){
+            return;
+          }
+          if(this->is_journaled() and not (this->is_coalescing and this->is_superseded(key, std::get<3>(item)))){
+            std::string payload = key;
+            serialize(std::get<1>(item), &payload);
+            serialize(std::get<2>(item), &payload);
+            serialize(std::get<3>(item), &payload);
 
             //
-            // Let the master process know that a backlog is no longer running.
+            // A new run appends to a new segment, in case the last one ends with a torn record.
             //
-            *is_processing_backlog = false;
+            const size_t record_bytes = record_header_bytes + payload.size();
+            if(not this->is_appending or this->segments.back().end + record_bytes > this->segments.back().size){
+              Segment segment;
+              if(not this->open_segment(this->next_number++, std::max(this->segment_bytes, header_bytes + record_bytes), &segment)){
+                this->enqueue(key, std::move(item));
+                return;
+              }
+              this->segments.push_back(segment);
+              this->is_appending = true;
+            }
+
+            Segment& segment = this->segments.back();
+            uint32_t payload_size = payload.size();
+            uint32_t checksum = crc32(payload.data(), payload.size());
+            std::memcpy(segment.memory + segment.end + record_header_bytes, payload.data(), payload.size());
+            std::memcpy(segment.memory + segment.end + sizeof(payload_size), &checksum, sizeof(checksum));
+            std::memcpy(segment.memory + segment.end, &payload_size, sizeof(payload_size));
+            segment.end += record_bytes;
+            this->pending++;
+            if(this->is_coalescing){
+              this->count(key, std::get<3>(item));
+            }
+          }
+          else if(not this->is_journaled()){
+            this->enqueue(key, std::move(item));
           }
-          catch(...){}
         }
 
-        //
-        // Acquire a lock one last time to ensure that the master thread isn't using the lock in the destructor.
-        //
-        {
-          std::lock_guard<std::mutex> lock( backlog_mutex );
+        // ****************************************************************************************************
+        /// @name            drain
+        ///
+        /// @brief           Queue every write waiting in the inbox.
+        ///
+        void drain(Inbox& inbox){
+          Item item;
+          while(inbox.pop(&item)){
+            this->push_back(std::move(item));
+          }
         }
-      });
+
+        // ****************************************************************************************************
+        /// @name            take
+        ///
+        /// @brief           Remove the next records to store: all of them without a journal, otherwise a batch.
+        ///                  Journaled records stay on disk until finish(), so if the process dies first they are
+        ///                  stored again on the next run. That is harmless, since each keeps its original timestamp.
+        ///
+        void take(std::deque<Item>* items){
+          if(this->queue.size() != 0){
+            items->insert(items->end(), std::make_move_iterator(this->queue.begin()), std::make_move_iterator(this->queue.end()));
+            this->queue.clear();
+            this->positions.clear();
+            this->front_position = 0;
+          }
+          while(this->pending != 0 and items->size() < max_records_per_take){
+            Segment& segment = this->segments.at(this->read_segment);
+            if(this->read_offset >= segment.end){
+              this->read_segment++;
+              this->read_offset = header_bytes;
+              continue;
+            }
+            std::string record = payload(segment, this->read_offset);
+            this->read_offset += record_header_bytes + record.size();
+            this->pending--;
+
+            Item item;
+            size_t key_size;
+            if(decode(record, &item, &key_size)){
+              if(this->is_coalescing){
+                auto newest = this->newest.find(record.substr(0, key_size));
+                if(newest != this->newest.end()){
+                  bool is_superseded = std::get<3>(item) < newest->second.first;
+                  if(--newest->second.second == 0){
+                    this->newest.erase(newest);
+                  }
+                  if(is_superseded){
+                    continue;
+                  }
+                }
+              }
+              items->push_back(std::move(item));
+            }
+          }
+        }
+
+        // ****************************************************************************************************
+        /// @name            finish
+        ///
+        /// @brief           Finish with the records taken. Those that couldn't be stored are put back, to be retried
+        ///                  first, or with a journal, last. The order doesn't matter to the database, since each record
+        ///                  keeps its timestamp. The journal then marks the rest as stored, deleting the segments that are done.
+        ///
+        void finish(std::vector<Item>&& unprocessed){
+          if(not this->is_journaled()){
+            for(auto item = unprocessed.rbegin(); item != unprocessed.rend(); ++item){
+              std::string key = this->is_coalescing ? keyToBytes(std::get<0>(*item), std::tuple_size<std::tuple<Keys...>>{},
+                                                                 typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{}) : "";
+              if(not this->is_coalescing or not this->replace(key, *item, true)){
+                if(this->is_coalescing){
+                  this->positions[key] = --this->front_position;
+                }
+                this->queue.push_front(std::move(*item));
+              }
+            }
+            return;
+          }
+          for(auto& item : unprocessed){
+            this->push_back(std::move(item));
+          }
+          #if defined(__unix__)
+          //
+          // Delete the segments that were read to the end, except the one still being appended to.
+          //
+          while(this->segments.size() != 0 and
+                (this->read_segment != 0 or
+                 (this->read_offset >= this->segments.front().end and (this->segments.size() > 1 or not this->is_appending)))){
+            this->unmap(this->segments.front());
+            unlink(this->filename(this->segments.front().number).c_str());
+            this->segments.pop_front();
+            if(this->read_segment != 0){
+              this->read_segment--;
+            }
+            else{
+              this->read_offset = header_bytes;
+            }
+          }
+          if(this->segments.size() != 0){
+            consumed(this->segments.front()) = this->read_offset;
+          }
+          #endif
+        }
+
+        // ****************************************************************************************************
+        /// @name            close
+        ///
+        /// @brief           Drop the records kept in memory, and flush and unmap the journal, which keeps the rest
+        ///                  for the next run. Records taken but not finished are stored again by the next run.
+        ///
+        void close(void){
+          this->queue.clear();
+          this->positions.clear();
+          this->newest.clear();
+          for(auto& segment : this->segments){
+            this->unmap(segment);
+          }
+          this->segments.clear();
+          this->is_appending = false;
+          this->pending = 0;
+          this->directory = "";
+          #if defined(__unix__)
+          if(this->lock_fd >= 0){
+            ::close(this->lock_fd);
+            this->lock_fd = -1;
+          }
+          #endif
+        }
+    };
+
+    CassCluster* cluster;
+    CassSession* session;
+    const CassPrepared* prepared_insert;
+    std::map<size_t, const CassPrepared*> prepared_selects;
+    std::map<size_t, const CassPrepared*> prepared_in_selects;
+
+    std::atomic<bool> is_initialized;
+    std::atomic<size_t> pending_requests;
+    std::thread backlog_thread;
+    InsertMode_t default_backlog_mode;
+    size_t store_many_max_in_flight;
+    size_t store_batch_max_statements;
+    std::atomic<size_t> partition_key_count;
+    std::vector<CassConsistency> read_consistencies;
+    std::vector<CassConsistency> write_consistencies;
+    std::vector<std::unique_ptr<CircuitBreaker>> read_breakers;
+    std::vector<std::unique_ptr<CircuitBreaker>> write_breakers;
+    size_t consistency_failure_threshold;
+    int64_t consistency_retry_us;
+    uint32_t read_timeout_ms;
+    uint32_t write_timeout_ms;
+    size_t read_hedge_percentile;
+    std::atomic<int64_t> read_hedge_delay_us;
+    std::mutex read_latency_mutex;
+    std::vector<int64_t> read_latencies;
+    size_t read_latency_count;
+    std::mutex hedge_mutex;
+    std::condition_variable hedge_condition;
+    std::multimap<std::chrono::steady_clock::time_point, Request*> hedge_timers;
+    std::thread hedge_thread;
+    bool is_hedge_thread_stopping;
+    std::atomic<bool>* do_terminate_thread_ptr;
+    std::shared_ptr<std::atomic<bool>> is_processing_backlog_ptr;
+    std::mutex* backlog_mutex_ptr;
+    Backlog* backlog_queue_ptr;
+    Inbox* backlog_inbox_ptr;
+    std::vector<std::string> keys;
+    std::unique_ptr<Cache> cache;
+    std::unique_ptr<ValuStorSharedCache> shared_cache;
+    bool is_selecting_ttl_writetime;
+    bool is_serving_stale_on_error;
+    bool is_coalescing_reads;
+    std::mutex flight_mutex;
+    std::unordered_map<std::string, std::shared_ptr<Flight>> flights; // The coalescable retrieve() in flight for each key and count.
+
+    std::map<std::string, std::string> config;
+    const std::map<std::string, std::string> default_config = {
+        {"table", "cache.values"},
+        {"key_field", "key_field"},
+        {"value_field", "value_field"},
+        {"username", "username"},
+        {"password", "password"},
+        {"hosts", "127.0.0.1"},
+        {"port", "9042"},
+        {"read_consistencies", "LOCAL_QUORUM, LOCAL_ONE, ONE"},
+        {"write_consistencies", "LOCAL_ONE, ONE, ANY"},
+        {"consistency_failure_threshold", "5"},
+        {"consistency_retry_ms", "2000"},
+        {"read_timeout_ms", "6000"},
+        {"write_timeout_ms", "6000"},
+        {"connect_timeout_ms", "4000"},
+        {"prepare_timeout_ms", "2000"},
+        {"read_hedge_percentile", "0"},
+        {"client_io_threads", "2"},
+        {"client_queue_size", "8192"},
+        {"client_server_connects_per_thread", "1"},
+        {"client_max_connects_per_thread", "2"},
+        {"client_max_conc_connect_creation", "1"},
+        {"client_max_concurrent_requests", "100"},
+        {"client_log_level", "2"},
+        {"default_backlog_mode", "1"},
+        {"backlog_journal_dir", ""},
+        {"backlog_journal_segment_mb", "16"},
+        {"backlog_coalesce", "0"},
+        {"store_many_max_in_flight", "256"},
+        {"store_batch_max_statements", "32"},
+        {"retrieve_in_max_keys", "32"},
+        {"cache_max_entries", "0"},
+        {"cache_max_mb", "0"},
+        {"cache_shards", "16"},
+        {"cache_ttl_ms", "1000"},
+        {"cache_degraded_ttl_ms", "100"},
+        {"cache_not_found_ttl_ms", "100"},
+        {"cache_max_stale_ms", "0"},
+        {"cache_serve_stale_on_error", "0"},
+        {"cache_admission_filter", "0"},
+        {"cache_warm_file", ""},
+        {"cache_snapshot_file", ""},
+        {"cache_warm_max_in_flight", "64"},
+        {"shm_cache_name", ""},
+        {"shm_cache_slots", "65536"},
+        {"shm_cache_slot_bytes", "1024"},
+        {"shm_cache_ttl_ms", "1000"},
+        {"select_ttl_writetime", "1"},
+        {"coalesce_reads", "1"},
+        {"server_trusted_cert", ""},
+        {"server_verify_mode", "0"},
+        {"client_ssl_cert", ""},
+        {"client_ssl_key", ""},
+        {"client_key_password", ""}
+      };
+
+  private:
+    // ****************************************************************************************************
+    /// @name            trim
+    ///
+    /// @brief           Trim the leading and trailing space from a string and return it.
+    ///
+    /// @param           str
+    ///
+    /// @return          copy of the trimmed string.
+    ///
+    static std::string trim(const std::string str){
+      std::string s = str;
+      s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](int c) {
+        return not std::isspace(c);
+      }));
+      s.erase(std::find_if(s.rbegin(), s.rend(), [](int c) {
+        return not std::isspace(c);
+      }).base(), s.end());
+      return s;
+    } // trim()
+
+    // ****************************************************************************************************
+    /// @name            str_to_int
+    ///
+    /// @brief           Convert a string to an integer, using a default value if an exception is thrown.
+    ///
+    /// @param           str
+    /// @param           default_value
+    ///
+    /// @return          The integer value converted from the string, or the default value on an error.
+    ///
+    static int str_to_int(std::string str, int default_value){
+      try{
+        return std::stoi(str);
+      }
+      catch(const std::exception& exception){
+        return default_value;
+      } // catch
+    } // str_to_int()
+
+    // ****************************************************************************************************
+    /// @name            configure
+    ///
+    /// @brief           Configure the connection. The interal configuration must be valid.
+    ///
+    void configure(void){
+      //
+      // Set the read/write consistencies
+      //
+      auto parse_consistencies = [](std::string str){
+        std::vector<CassConsistency> consistencies;
+        std::stringstream ss(str);
+        std::string element;
+        while(std::getline(ss, element, ','))
+        {
+          element = trim(element);
+          CassConsistency consistency = element == "ALL"          ? CASS_CONSISTENCY_ALL :
+                                        element == "EACH_QUORUM"  ? CASS_CONSISTENCY_EACH_QUORUM :
+                                        element == "QUORUM"       ? CASS_CONSISTENCY_QUORUM :
+                                        element == "LOCAL_QUORUM" ? CASS_CONSISTENCY_LOCAL_QUORUM :
+                                        element == "ONE"          ? CASS_CONSISTENCY_ONE :
+                                        element == "TWO"          ? CASS_CONSISTENCY_THREE :
+                                        element == "LOCAL_ONE"    ? CASS_CONSISTENCY_LOCAL_ONE :
+                                        element == "ANY"          ? CASS_CONSISTENCY_ANY :
+                                        element == "SERIAL"       ? CASS_CONSISTENCY_SERIAL :
+                                        element == "LOCAL_SERIAL" ? CASS_CONSISTENCY_LOCAL_SERIAL :
+                                                                    CASS_CONSISTENCY_UNKNOWN;
+          if(consistency != CASS_CONSISTENCY_UNKNOWN){
+            consistencies.push_back(consistency);
+          }
+        }
+        if(consistencies.size() == 0){
+          consistencies.push_back(CASS_CONSISTENCY_ANY);
+        }
+        return consistencies;
+      };
+      this->read_consistencies = parse_consistencies(config.at("read_consistencies"));
+      this->write_consistencies = parse_consistencies(config.at("write_consistencies"));
+
+      //
+      // Set up a circuit breaker for each consistency level, so that a level which keeps failing is skipped for a while.
+      //
+      for(size_t ndx = 0; ndx < this->read_consistencies.size(); ndx++){
+        this->read_breakers.push_back(std::unique_ptr<CircuitBreaker>(new CircuitBreaker()));
+      }
+      for(size_t ndx = 0; ndx < this->write_consistencies.size(); ndx++){
+        this->write_breakers.push_back(std::unique_ptr<CircuitBreaker>(new CircuitBreaker()));
+      }
+      this->consistency_failure_threshold = std::max(0, str_to_int(config.at("consistency_failure_threshold"), 5));
+      this->consistency_retry_us = 1000L * std::max(1, str_to_int(config.at("consistency_retry_ms"), 2000));
+
+      //
+      // Set the total time allowed for each retrieve() and store(), across all of their consistency levels.
+      //
+      this->read_timeout_ms = std::max(0, str_to_int(config.at("read_timeout_ms"), 6000));
+      this->write_timeout_ms = std::max(0, str_to_int(config.at("write_timeout_ms"), 6000));
+
+      //
+      // Set the read latency percentile after which the next read consistency is tried in parallel. '0' disables hedging.
+      //
+      this->read_hedge_percentile = std::min(100, std::max(0, str_to_int(config.at("read_hedge_percentile"), 0)));
+
+      //
+      // Set the default backlog mode.
+      //
+      int backlog_mode = str_to_int(config.at("default_backlog_mode"), 1);
+      this->default_backlog_mode = backlog_mode == 0 ? DISALLOW_BACKLOG :
+                                   backlog_mode == 2 ? USE_ONLY_BACKLOG :
+                                                       ALLOW_BACKLOG;
+
+      //
+      // Set the maximum number of outstanding writes used by store_many().
+      //
+      int max_in_flight = str_to_int(config.at("store_many_max_in_flight"), 256);
+      this->store_many_max_in_flight = max_in_flight > 0 ? max_in_flight : 1;
+      int max_statements = str_to_int(config.at("store_batch_max_statements"), 32);
+      this->store_batch_max_statements = max_statements > 0 ? max_statements : 1;
+
+      //
+      // Share a single SELECT among identical retrieve() calls that are in flight at the same time.
+      //
+      this->is_coalescing_reads = str_to_int(config.at("coalesce_reads"), 1) != 0;
+
+      //
+      // Create the in-process cache, if enabled.
+      //
+      int cache_max_entries = std::max(0, str_to_int(config.at("cache_max_entries"), 0));
+      int cache_max_mb = std::max(0, str_to_int(config.at("cache_max_mb"), 0));
+      if(cache_max_entries > 0 or cache_max_mb > 0){
+        //
+        // When the database can't be reached, retrieve() may answer with the last value cached, even if it expired.
+        //
+        this->is_serving_stale_on_error = str_to_int(config.at("cache_serve_stale_on_error"), 0) != 0;
+        this->cache.reset(new Cache(cache_max_entries, static_cast<size_t>(cache_max_mb) << 20,
+                                    std::max(1, str_to_int(config.at("cache_shards"), 16)),
+                                    std::chrono::milliseconds(std::max(0, str_to_int(config.at("cache_ttl_ms"), 1000))),
+                                    std::chrono::milliseconds(std::max(0, str_to_int(config.at("cache_degraded_ttl_ms"), 100))),
+                                    std::chrono::milliseconds(std::max(0, str_to_int(config.at("cache_not_found_ttl_ms"), 100))),
+                                    std::chrono::milliseconds(std::max(0, str_to_int(config.at("cache_max_stale_ms"), 0))),
+                                    this->is_serving_stale_on_error,
+                                    str_to_int(config.at("cache_admission_filter"), 0) != 0));
+
+        //
+        // Also read each row's TTL() and WRITETIME(), so cached entries don't outlive the rows in the database.
+        //
+        this->is_selecting_ttl_writetime = str_to_int(config.at("select_ttl_writetime"), 1) != 0;
+      }
+
+      //
+      // Open the cache shared with the other processes on this host, if enabled.
+      //
+      if(config.at("shm_cache_name") != ""){
+        std::string shm_cache_name = config.at("shm_cache_name");
+        this->shared_cache.reset(new ValuStorSharedCache(shm_cache_name.front() == '/' ? shm_cache_name : "/" + shm_cache_name,
+                                                         std::max(1, str_to_int(config.at("shm_cache_slots"), 65536)),
+                                                         std::max(1, str_to_int(config.at("shm_cache_slot_bytes"), 1024)),
+                                                         std::max(0, str_to_int(config.at("shm_cache_ttl_ms"), 1000))));
+        if(not this->shared_cache->is_open()){
+          this->shared_cache.reset();
+        }
+        else{
+          this->is_selecting_ttl_writetime = str_to_int(config.at("select_ttl_writetime"), 1) != 0;
+        }
+      }
+
+      //
+      // Retrieve the keys
+      //
+      std::stringstream ss(this->config.at("key_field"));
+      std::string field;
+      while(std::getline(ss, field, ',')){
+        field = trim(field);
+        if(field != ""){
+          keys.push_back(field);
+        }
+      }
+
+      //
+      // Set the log level
+      //
+      int log_level = str_to_int(config.at("client_log_level"), 2);
+      cass_log_set_level(log_level == 0 ? CASS_LOG_DISABLED :
+                         log_level == 1 ? CASS_LOG_CRITICAL :
+                         log_level == 2 ? CASS_LOG_ERROR :
+                         log_level == 3 ? CASS_LOG_WARN :
+                         log_level == 4 ? CASS_LOG_INFO :
+                         log_level == 5 ? CASS_LOG_DEBUG :
+                                          CASS_LOG_TRACE);
+
+      //
+      // Create the cluster profile once.
+      //
+      this->cluster = cass_cluster_new();
+      std::string username = config.at("username");
+      std::string password = config.at("password");
+      if(username != "" or password != ""){
+        cass_cluster_set_credentials(this->cluster, username.c_str(), password.c_str());
+      }
+      cass_cluster_set_contact_points(this->cluster, config.at("hosts").c_str());
+      cass_cluster_set_port(this->cluster, str_to_int(config.at("port"), 9042));
+      cass_cluster_set_num_threads_io(this->cluster, str_to_int(config.at("client_io_threads"), 2));
+      cass_cluster_set_queue_size_io(this->cluster, str_to_int(config.at("client_queue_size"), 8192));
+      cass_cluster_set_core_connections_per_host(this->cluster, str_to_int(config.at("client_server_connects_per_thread"), 1));
+      cass_cluster_set_max_connections_per_host(this->cluster, str_to_int(config.at("client_max_connects_per_thread"), 2));
+      cass_cluster_set_max_concurrent_creation(this->cluster, str_to_int(config.at("client_max_conc_connect_creation"), 1));
+      cass_cluster_set_max_concurrent_requests_threshold(this->cluster, str_to_int(config.at("client_max_concurrent_requests"), 100));
+      cass_cluster_set_connect_timeout(this->cluster, str_to_int(config.at("connect_timeout_ms"), 4000));
+
+      //
+      // Setup SSL (https://docs.datastax.com/en/developer/cpp-driver/2.0/topics/security/ssl/)
+      //
+      std::string server_trusted_cert = config.count("server_trusted_cert") ? config.at("server_trusted_cert") : "";
+      std::string client_ssl_cert = config.count("client_ssl_cert") ? config.at("client_ssl_cert") : "";
+      std::string client_ssl_key = config.count("client_ssl_key") ? config.at("client_ssl_key") : "";
+
+      if(server_trusted_cert != "" or
+         (client_ssl_cert != "" and client_ssl_key != "")){
+        CassSsl* ssl = cass_ssl_new();
+
+        //
+        // Server Certificate
+        //
+        if(server_trusted_cert != ""){
+          auto load_trusted_cert_file = [](const char* file, CassSsl* ssl) -> CassError{
+            std::ifstream input_file_stream(file);
+            std::stringstream string_buffer;
+            string_buffer << input_file_stream.rdbuf();
+            std::string certificate = string_buffer.str();
+            return cass_ssl_add_trusted_cert(ssl, certificate.c_str());
+          };
+          std::stringstream ss(server_trusted_cert);
+          std::string cert;
+          while(std::getline(ss, cert, ','))
+          {
+            cert = trim(cert);
+            if(cert != ""){
+              load_trusted_cert_file(cert.c_str(), ssl);
+            }
+          }
+
+          int verify_mode = str_to_int(config.at("server_verify_mode"), 1);
+          cass_ssl_set_verify_flags(ssl, verify_mode == 0 ? CASS_SSL_VERIFY_NONE :
+                                         verify_mode == 2 ? CASS_SSL_VERIFY_PEER_CERT | CASS_SSL_VERIFY_PEER_IDENTITY :
+                                         verify_mode == 3 ? CASS_SSL_VERIFY_PEER_CERT | CASS_SSL_VERIFY_PEER_IDENTITY_DNS :
+                                                            CASS_SSL_VERIFY_PEER_CERT);
+        }
+
+        //
+        // Client Certificate (Authentication)
+        //
+        if(client_ssl_cert != "" and client_ssl_key != ""){
+          auto load_ssl_cert = [](const char* file, CassSsl* ssl) -> CassError{
+            std::ifstream input_file_stream(file);
+            std::stringstream string_buffer;
+            string_buffer << input_file_stream.rdbuf();
+            std::string certificate = string_buffer.str();
+            return cass_ssl_set_cert(ssl, certificate.c_str());
+          };
+          load_ssl_cert(client_ssl_cert.c_str(), ssl);
+          auto load_private_key = [](const char* file, CassSsl* ssl, const char* key_password) -> CassError{
+            std::ifstream input_file_stream(file);
+            std::stringstream string_buffer;
+            string_buffer << input_file_stream.rdbuf();
+            std::string certificate = string_buffer.str();
+            return cass_ssl_set_private_key(ssl, certificate.c_str(), key_password);
+          };
+          load_private_key(client_ssl_key.c_str(), ssl,
+              config.count("client_key_password") and config.at("client_key_password") != "" ?
+                        config.at("client_key_password").c_str() : nullptr);
+        }
+
+        cass_cluster_set_ssl(this->cluster, ssl);
+        cass_ssl_free(ssl);
+      }
+    } // configure()
+
+    // ****************************************************************************************************
+    /// @name            run_backlog_thread
+    ///
+    /// @brief           Run the backlog thread.
+    ///
+    void run_backlog_thread(void){
+      //
+      // Start the backlog thread
+      //
+      std::atomic<bool> are_pointers_setup(false);
+
+      // *****************************************************************************
+      /// @name           initialize
+      ///
+      /// @brief          Initialize the connection given a valid CassCluster* already setup.
+      ///
+      auto initialize = [&](void){
+        const cass_duration_t connect_timeout_us = 1000L * std::max(1, str_to_int(this->config.at("connect_timeout_ms"), 4000));
+        const cass_duration_t prepare_timeout_us = 1000L * std::max(1, str_to_int(this->config.at("prepare_timeout_ms"), 2000));
+        this->session = cass_session_new();
+        if(this->session != nullptr){
+          CassFuture* connect_future = cass_session_connect(this->session, cluster);
+          if(connect_future != nullptr){
+            if (cass_future_wait_timed(connect_future, connect_timeout_us) and cass_future_error_code(connect_future) == CASS_OK) {
+              //
+              // Build the INSERT prepared statement
+              //
+              {
+                std::string statement = "INSERT INTO " + this->config.at("table") + " (" + this->config.at("key_field") +
+                                        ", " + this->config.at("value_field") + ") VALUES (";
+                for(size_t ndx = 0; ndx < keys.size(); ndx++){
+                  statement += "?,";
+                }
+                statement += "?) USING TTL ?";
+
+                CassFuture* future = cass_session_prepare(this->session, statement.c_str());
+                if(future != nullptr){
+                  if (cass_future_wait_timed(future, prepare_timeout_us) and cass_future_error_code(future) == CASS_OK) {
+                    this->prepared_insert = cass_future_get_prepared(future);
+                  }
+                  else{
+                    //
+                    // Error: Unable to prepare insert statement
+                    //
+                  }
+                  cass_future_free(future);
+                }
+              }
+
+              //
+              // Build the SELECT prepared statements
+              // The TTL() and WRITETIME() columns, if selected, directly follow the value.
+              //
+              const std::string ttl_writetime_columns = not this->is_selecting_ttl_writetime ? "" :
+                ",TTL(" + this->config.at("value_field") + "),WRITETIME(" + this->config.at("value_field") + ")";
+              {
+                for(size_t total = 1; total <= keys.size(); total++){
+                  // total == # of keys to move to the WHERE clause.
+                  std::string statement = "SELECT " + this->config.at("value_field") + ttl_writetime_columns;
+                  for(size_t value = total; value < keys.size(); value++){
+                    statement += "," + keys.at(value);
+                  }
+                  statement += " FROM " + this->config.at("table") + " WHERE ";
+                  for(size_t key = 0; key < total; key++){
+                    statement += (key != 0 ? " AND " : "") + keys.at(key) + "=?";
+                  }
+
+                  CassFuture* future = cass_session_prepare(this->session, statement.c_str());
+                  if(future != nullptr){
+                    if (cass_future_wait_timed(future, prepare_timeout_us) and cass_future_error_code(future) == CASS_OK) {
+                      this->prepared_selects[total] = cass_future_get_prepared(future);
+                    }
+                    else{
+                      //
+                      // Error: Unable to prepare select statement
+                      //
+                    }
+                    cass_future_free(future);
+                  }
+                }
+              }
+
+              //
+              // Build the SELECT ... IN prepared statements used by retrieve_many() for rows in the same partition.
+              // They are bucketed by powers of two, up to 'retrieve_in_max_keys' values in the IN clause.
+              //   2: SELECT v,k3 FROM cache.tbl131 WHERE k1=? AND k2=? AND k3 IN (?,?)
+              //   4: SELECT v,k3 FROM cache.tbl131 WHERE k1=? AND k2=? AND k3 IN (?,?,?,?)
+              //
+              if(keys.size() > 1){
+                // Clamped to [1, 1024], since a negative value would otherwise wrap around to an unbounded loop. Below 2 disables it.
+                int max_in_keys_config = str_to_int(this->config.at("retrieve_in_max_keys"), 32);
+                size_t max_in_keys = std::min(std::max(1, max_in_keys_config), 1024);
+                for(size_t bucket = 2; bucket <= max_in_keys; bucket *= 2){
+                  std::string statement = "SELECT " + this->config.at("value_field") + ttl_writetime_columns + "," + keys.back() +
+                                          " FROM " + this->config.at("table") + " WHERE ";
+                  for(size_t key = 0; key + 1 < keys.size(); key++){
+                    statement += keys.at(key) + "=? AND ";
+                  }
+                  statement += keys.back() + " IN (?";
+                  for(size_t ndx = 1; ndx < bucket; ndx++){
+                    statement += ",?";
+                  }
+                  statement += ")";
+
+                  CassFuture* future = cass_session_prepare(this->session, statement.c_str());
+                  if(future != nullptr){
+                    if (cass_future_wait_timed(future, prepare_timeout_us) and cass_future_error_code(future) == CASS_OK) {
+                      this->prepared_in_selects[bucket] = cass_future_get_prepared(future);
+                    }
+                    cass_future_free(future);
+                  }
+                }
+              }
+
+              //
+              // Look up how many of the keys make up the partition key, so that store_batched() can group by partition.
+              //
+              {
+                std::string table = this->config.at("table");
+                size_t separator = table.find('.');
+                const CassSchemaMeta* schema_meta = cass_session_get_schema_meta(this->session);
+                if(schema_meta != nullptr and separator != std::string::npos){
+                  const CassKeyspaceMeta* keyspace_meta = cass_schema_meta_keyspace_by_name(schema_meta, trim(table.substr(0, separator)).c_str());
+                  if(keyspace_meta != nullptr){
+                    const CassTableMeta* table_meta = cass_keyspace_meta_table_by_name(keyspace_meta, trim(table.substr(separator + 1)).c_str());
+                    if(table_meta != nullptr){
+                      this->partition_key_count = cass_table_meta_partition_key_count(table_meta);
+                    }
+                  }
+                }
+                if(schema_meta != nullptr){
+                  cass_schema_meta_free(schema_meta);
+                }
+              }
+            }
+            else{
+              //
+              // Error: Unable to connect
+              //
+            }
+            cass_future_free(connect_future);
+
+            if(this->session != nullptr and this->prepared_insert != nullptr and this->prepared_selects.size() != 0){
+              this->is_initialized = true;
+            }
+            else{
+              if(this->prepared_insert != nullptr){
+                cass_prepared_free(this->prepared_insert);
+                this->prepared_insert = nullptr;
+              }
+              for(const auto& pair : this->prepared_selects){
+                if(pair.second != nullptr){
+                  cass_prepared_free(pair.second);
+                }
+              }
+              this->prepared_selects.clear();
+              for(const auto& pair : this->prepared_in_selects){
+                if(pair.second != nullptr){
+                  cass_prepared_free(pair.second);
+                }
+              }
+              this->prepared_in_selects.clear();
+            }
+          }
+          if(not this->is_initialized and this->session != nullptr){
+            cass_session_free(this->session);
+            this->session = nullptr;
+          }
+        }        
+      };
+
+      // *****************************************************************************
+      /// @name           backlog_thread
+      ///
+      /// @brief          The backlog thread handles initializing the connection and manages the backlog queue.
+      ///
+      this->backlog_thread = std::thread([&, initialize](void){
+        //
+        // Setup the pointers back to the master thread.
+        // The backlog thread will never close until the master thread tells it to close.
+        // At that point it can terminate after the master thread, so it must control the data to prevent seg faults.
+        //
+        std::atomic<bool> do_terminate_thread(false);
+        std::mutex backlog_mutex;
+        std::shared_ptr<std::atomic<bool>> is_processing_backlog = this->is_processing_backlog_ptr;
+        Backlog backlog_queue(this->config.at("backlog_journal_dir"),
+                              static_cast<size_t>(std::max(1, str_to_int(this->config.at("backlog_journal_segment_mb"), 16))) << 20,
+                              str_to_int(this->config.at("backlog_coalesce"), 0) != 0);
+        Inbox backlog_inbox;
+
+        this->do_terminate_thread_ptr = &do_terminate_thread;
+        this->backlog_mutex_ptr = &backlog_mutex;
+        this->backlog_queue_ptr = &backlog_queue;
+        this->backlog_inbox_ptr = &backlog_inbox;
+
+        //
+        // This tells the master thread that we are processing.
+        // It will not go out of scope until we set processing to 'false', allowing both threads to poll is_initialized without locking.
+        //
+        *is_processing_backlog = true;
+
+        //
+        // Notify the master thread that the pointers are setup and it is okay for 'are_pointers_setup' to go out-of-scope.
+        //
+        are_pointers_setup = true;
+
+        //
+        // Wait for the thread to initialize.
+        // During this period, the master thread cannot destruct since we are still accessing "is_initialized"
+        // "do_terminate_thread" must be set first.
+        // Once initialization takes place, we never need to access it again.
+        //
+        initialize();
+        while(not do_terminate_thread and not this->is_initialized){
+          try{
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            initialize();
+          }
+          catch(...){}
+        }
+
+        //
+        // Warm up the cache from the configured key files, before the destructor may proceed.
+        //
+        for(const char* option : {"cache_warm_file", "cache_snapshot_file"}){
+          if(not do_terminate_thread and this->is_initialized and this->config.at(option) != ""){
+            try{
+              this->warm_cache_from_file(this->config.at(option));
+            }
+            catch(...){}
+          }
+        }
+        *is_processing_backlog = false;
+        while(not do_terminate_thread){
+          try{
+            std::this_thread::sleep_for(std::chrono::seconds(2));
+
+            //
+            // Take the entries in the backlog, a batch at a time, until it is empty or some can't be sent.
+            //
+            bool is_failing = false;
+            while(not is_failing){
+              std::deque<typename Backlog::Item> backlog;
+              {
+                std::lock_guard<std::mutex> lock( backlog_mutex );
+                if(not do_terminate_thread){
+                  backlog_queue.drain(backlog_inbox);
+                  backlog_queue.take(&backlog);
+                }
+                *is_processing_backlog = backlog.size() > 0 and not do_terminate_thread;
+              }
+              if(not *is_processing_backlog){
+                break;
+              }
+
+              //
+              // Attempt to process the backlog.
+              //
+              std::vector<typename Backlog::Item> unprocessed;
+              for(auto& request : backlog){
+                if(not do_terminate_thread){
+                  //
+                  // Proxy the call to store().
+                  // We need to unpack the tuple<Keys...> into paramters to store().
+                  //
+                  ValuStor::Result result = this->call_store(std::get<0>(request), // tuple<Keys...>
+                                                             std::get<1>(request), // Val_T
+                                                             std::get<2>(request), // TTL
+                                                             DISALLOW_BACKLOG,     // InsertMode
+                                                             std::get<3>(request), // insert time
+                                                             typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{});
+                  if(not result){
+                    unprocessed.push_back(request);
+                  }
+                }
+              }
+
+              //
+              // Reinsert the failed requests back into the queue.
+              //
+              is_failing = unprocessed.size() != 0;
+              for(auto& request : unprocessed){
+                this->write_through(std::get<0>(request), std::get<1>(request), std::get<2>(request), std::get<3>(request), true);
+              }
+              {
+                std::lock_guard<std::mutex> lock( backlog_mutex );
+                if(not do_terminate_thread){
+                  backlog_queue.finish(std::move(unprocessed));
+                }
+              }
+            }
+
+            //
+            // Let the master process know that a backlog is no longer running.
+            //
+            *is_processing_backlog = false;
+          }
+          catch(...){}
+        }
+
+        //
+        // Acquire a lock one last time to ensure that the master thread isn't using the lock in the destructor.
+        //
+        {
+          std::lock_guard<std::mutex> lock( backlog_mutex );
+        }
+      });
+
+      //
+      // Wait for the thread to initialize and detach it from this thread.
+      //
+      backlog_thread.detach();
+      while(not are_pointers_setup){
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+      }
+    } // run_backlog_thread()
+
+  public:
+    // ****************************************************************************************************
+    /// @name            constructor
+    ///
+    /// @brief           Create a ValuStor, loading the configuration from the supplied configuration.
+    ///
+    ValuStor(const std::map<std::string, std::string> configuration):
+      cluster(nullptr),
+      session(nullptr),
+      prepared_insert(nullptr),
+      is_initialized(false),
+      pending_requests(0),
+      default_backlog_mode(ALLOW_BACKLOG),
+      store_many_max_in_flight(256),
+      store_batch_max_statements(32),
+      partition_key_count(0),
+      consistency_failure_threshold(5),
+      consistency_retry_us(2000000),
+      read_timeout_ms(6000),
+      write_timeout_ms(6000),
+      read_hedge_percentile(0),
+      read_hedge_delay_us(0),
+      read_latency_count(0),
+      is_hedge_thread_stopping(false),
+      do_terminate_thread_ptr(nullptr),
+      is_processing_backlog_ptr(new std::atomic<bool>(false)),
+      backlog_mutex_ptr(nullptr),
+      backlog_queue_ptr(nullptr),
+      backlog_inbox_ptr(nullptr),
+      is_selecting_ttl_writetime(false),
+      is_serving_stale_on_error(false),
+      is_coalescing_reads(true)
+    {
+      //
+      // Use the configuration supplied.
+      //
+      for(const auto& pair : configuration){
+        std::string key = trim(pair.first);
+        if(this->default_config.count(key) != 0){
+          this->config[key] = pair.second;
+        }
+      }
+
+      //
+      // Add in any missing defaults
+      //
+      for(const auto& pair : this->default_config){
+        std::string key = trim(pair.first);
+        if(this->config.count(key) == 0){
+          this->config[key] = pair.second;
+        }
+      }
+
+      //
+      // Configure the connection
+      //
+      this->configure();
+
+      //
+      // Start the backlog thread (which will perform initialization)
+      //
+      this->run_backlog_thread();
+
+      //
+      // Start the hedge thread, if hedged reads are enabled.
+      //
+      if(this->read_hedge_percentile > 0){
+        this->hedge_thread = std::thread(&ValuStor::run_hedge_thread, this);
+      }
+    }
+
+    // ****************************************************************************************************
+    /// @name            constructor
+    ///
+    /// @brief           Create a ValuStor, loading the configuration from a file.
+    ///
+    ValuStor(const std::string config_filename):
+      cluster(nullptr),
+      session(nullptr),
+      prepared_insert(nullptr),
+      is_initialized(false),
+      pending_requests(0),
+      default_backlog_mode(ALLOW_BACKLOG),
+      store_many_max_in_flight(256),
+      store_batch_max_statements(32),
+      partition_key_count(0),
+      consistency_failure_threshold(5),
+      consistency_retry_us(2000000),
+      read_timeout_ms(6000),
+      write_timeout_ms(6000),
+      read_hedge_percentile(0),
+      read_hedge_delay_us(0),
+      read_latency_count(0),
+      is_hedge_thread_stopping(false),
+      do_terminate_thread_ptr(nullptr),
+      is_processing_backlog_ptr(new std::atomic<bool>(false)),
+      backlog_mutex_ptr(nullptr),
+      backlog_queue_ptr(nullptr),
+      backlog_inbox_ptr(nullptr),
+      is_selecting_ttl_writetime(false),
+      is_serving_stale_on_error(false),
+      is_coalescing_reads(true)
+    {
+      //
+      // Load in the config
+      //
+      config = default_config;
+      try{
+        std::ifstream config_file(config_filename);
+        std::string line;
+        while(std::getline(config_file, line)){
+          auto comment_marker = line.find("#");
+          if(comment_marker != std::string::npos) {
+            line = line.substr(0, comment_marker);
+          }
+
+          auto equal_marker = line.find("=");
+          if(equal_marker != std::string::npos){
+            this->config[trim(line.substr(0, equal_marker))] = trim(line.substr(equal_marker + 1));
+          }
+        }
+      }
+      catch(const std::exception& exception){}
+
+      //
+      // Configure the connection
+      //
+      this->configure();
+
+      //
+      // Start the backlog thread (which will perform initialization)
+      //
+      this->run_backlog_thread();
+
+      //
+      // Start the hedge thread, if hedged reads are enabled.
+      //
+      if(this->read_hedge_percentile > 0){
+        this->hedge_thread = std::thread(&ValuStor::run_hedge_thread, this);
+      }
+    }
+
+    // ****************************************************************************************************
+    /// @name            destructor
+    ///
+    /// @brief           Close the connection, the backlog thread, and free up allocations.
+    ///
+    ///
+    ~ValuStor(void)
+    {
+      //
+      // Wait for any asynchronous requests still in flight first. A failed store() may still add to the backlog,
+      // which belongs to the backlog thread and is destroyed once that thread has been terminated.
+      // With no requests pending, no hedge timers are left either, so the hedge thread can be stopped.
+      //
+      while(this->pending_requests != 0){
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      {
+        std::lock_guard<std::mutex> lock(this->hedge_mutex);
+        this->is_hedge_thread_stopping = true;
+      }
+      if(this->hedge_thread.joinable()){
+        this->hedge_condition.notify_one();
+        this->hedge_thread.join();
+      }
+
+      //
+      // Terminate the backlog thread, but be careful as state is shared.
+      // By terminating the thread and clearing the queue while holding the lock, we can prevent most race conditions.
+      //
+      bool was_backlog_running = false;
+      {
+        std::lock_guard<std::mutex> lock(*this->backlog_mutex_ptr);
+        was_backlog_running = *this->is_processing_backlog_ptr;
+        this->backlog_queue_ptr->drain(*this->backlog_inbox_ptr);
+        this->backlog_queue_ptr->close();
+        *this->do_terminate_thread_ptr = true;
+      }
+
+      //
+      // If the backlog thread was processing, we must wait for it to finish so it isn't accessing any of this' data.
+      // When it isn't in processing, it cannot reenter processing without knowing that "do_terminate_thread" was set.
+      // If the backlog was not running, it is impossible for there to be a race condition.
+      //
+      if(was_backlog_running){
+        while(*this->is_processing_backlog_ptr){
+          std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+      }
+
+      //
+      // Wait for any requests the backlog thread still had in flight, since their callbacks use the session and this' data.
+      //
+      while(this->pending_requests != 0){
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      if(this->config.at("cache_snapshot_file") != ""){
+        this->save_cache_snapshot(this->config.at("cache_snapshot_file"));
+      }
+
+      //
+      // Close up the cassandra connection.
+      //
+      for(const auto& pair : this->prepared_selects){
+        if(pair.second != nullptr){
+          cass_prepared_free(pair.second);
+        }
+      }
+      this->prepared_selects.clear();
+      for(const auto& pair : this->prepared_in_selects){
+        if(pair.second != nullptr){
+          cass_prepared_free(pair.second);
+        }
+      }
+      this->prepared_in_selects.clear();
+      if(this->prepared_insert != nullptr){
+        cass_prepared_free(this->prepared_insert);
+      }
+      if(this->session != nullptr){
+        cass_session_free(this->session);
+      }
+      if(this->cluster != nullptr){
+        cass_cluster_free(this->cluster);
+      }
+    }
+
+  private:
+    // ****************************************************************************************************
+    /// @name            logFutureErrorMessage
+    ///
+    static std::string logFutureErrorMessage(CassFuture* future, const std::string& description){
+      const char* message;
+      size_t message_length;
+      if(future != nullptr){
+        cass_future_error_message(future, &message, &message_length);
+      }
+      return "Scylla Error: " + description + ": '" + std::string(message, message_length) + "'";
+    }
+
+  private:
+    // ****************************************************************************************************
+    /// @class         Request
+    ///
+    /// @brief         The state of a single store() or retrieve() while it works its way down the consistency levels.
+    ///                It is reference counted by its attempts in flight and any hedge timer, and is deleted once its
+    ///                callback has been invoked and the last of them has let go.
+    ///
+    class Request
+    {
+      public:
+        ValuStor* const valustor;
+        CassStatement* const statement;
+        CassBatch* const batch;
+        const std::vector<CassConsistency>& consistencies;
+        const bool is_select;
+        const size_t count;
+        std::tuple<Keys...> keys;
+        const Val_T value;
+        const int32_t seconds_ttl;
+        const InsertMode_t insert_mode;
+        const int64_t insert_microseconds_since_epoch;
+        const std::chrono::steady_clock::time_point deadline;
+        size_t level;
+        ErrorCode_t error_code;
+        std::string error_message;
+        CassConsistency answered_consistency;
+        std::vector<std::pair<Val_T, std::tuple<Keys...>>> retrieved_data;
+        std::vector<int32_t> retrieved_ttls;
+        std::vector<int64_t> retrieved_write_times;
+        Callback callback;
+
+        std::mutex mutex;
+        size_t references;
+        size_t in_flight;
+        bool is_completed;
+        const CassPrepared* hedge_prepared;
+        CassStatement* hedge_statement;
+
+        //
+        // A timeout of '0' means there is no deadline.
+        //
+        static std::chrono::steady_clock::time_point deadline_from(uint32_t timeout_ms){
+          return timeout_ms == 0 ? std::chrono::steady_clock::time_point::max() :
+                                   std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        }
+
+        Request(ValuStor* valustor,
+                CassStatement* statement,
+                const std::vector<CassConsistency>& consistencies,
+                bool is_select,
+                size_t count,
+                std::tuple<Keys...>&& keys,
+                const Val_T& value,
+                int32_t seconds_ttl,
+                InsertMode_t insert_mode,
+                int64_t insert_microseconds_since_epoch,
+                uint32_t timeout_ms,
+                Callback&& callback):
+          valustor(valustor),
+          statement(statement),
+          batch(nullptr),
+          consistencies(consistencies),
+          is_select(is_select),
+          count(count),
+          keys(std::move(keys)),
+          value(value),
+          seconds_ttl(seconds_ttl),
+          insert_mode(insert_mode),
+          insert_microseconds_since_epoch(insert_microseconds_since_epoch),
+          deadline(deadline_from(timeout_ms)),
+          level(0),
+          error_code(UNKNOWN_ERROR),
+          error_message("Scylla Error"),
+          answered_consistency(CASS_CONSISTENCY_UNKNOWN),
+          callback(std::move(callback)),
+          references(1),
+          in_flight(0),
+          is_completed(false),
+          hedge_prepared(nullptr),
+          hedge_statement(nullptr)
+        {}
+
+        Request(ValuStor* valustor,
+                CassBatch* batch,
+                const std::vector<CassConsistency>& consistencies,
+                uint32_t timeout_ms,
+                Callback&& callback):
+          valustor(valustor),
+          statement(nullptr),
+          batch(batch),
+          consistencies(consistencies),
+          is_select(false),
+          count(0),
+          keys(),
+          value(),
+          seconds_ttl(0),
+          insert_mode(DISALLOW_BACKLOG),
+          insert_microseconds_since_epoch(0),
+          deadline(deadline_from(timeout_ms)),
+          level(0),
+          error_code(UNKNOWN_ERROR),
+          error_message("Scylla Error"),
+          answered_consistency(CASS_CONSISTENCY_UNKNOWN),
+          callback(std::move(callback)),
+          references(1),
+          in_flight(0),
+          is_completed(false),
+          hedge_prepared(nullptr),
+          hedge_statement(nullptr)
+        {}
+    };
+
+    // ****************************************************************************************************
+    /// @class         Attempt
+    ///
+    /// @brief         One execution of a request at a single consistency level, passed to the driver callback.
+    ///
+    class Attempt
+    {
+      public:
+        Request* const request;
+        const size_t level;
+        const std::chrono::steady_clock::time_point start_time;
+
+        Attempt(Request* request, size_t level):
+          request(request),
+          level(level),
+          start_time(std::chrono::steady_clock::now())
+        {}
+    };
+
+    // ****************************************************************************************************
+    /// @name            launch
+    ///
+    /// @brief           Send one attempt of the request at the given consistency level using the given statement.
+    ///                  What remains of the request's deadline is split evenly across the remaining consistency levels,
+    ///                  so a level that fails quickly leaves more time for the levels after it.
+    ///
+    /// @return          'true' if the driver will call on_request_complete(), 'false' if the attempt failed immediately.
+    ///
+    static bool launch(Request* request, CassStatement* statement, size_t level){
+      if(request->deadline != std::chrono::steady_clock::time_point::max()){
+        int64_t remaining_ms = std::chrono::duration_cast<std::chrono::milliseconds>(request->deadline - std::chrono::steady_clock::now()).count();
+        if(remaining_ms <= 0){
+          std::lock_guard<std::mutex> lock(request->mutex);
+          request->error_code = QUERY_ERROR;
+          request->error_message = "Scylla Error: Deadline exceeded";
+          request->level = request->consistencies.size(); // Don't try any more levels.
+          return false;
+        }
+        cass_uint64_t attempt_ms = std::max<int64_t>(1, remaining_ms / (request->consistencies.size() - level));
+        if(request->batch != nullptr){
+          cass_batch_set_request_timeout(request->batch, attempt_ms);
+        }
+        else{
+          cass_statement_set_request_timeout(statement, attempt_ms);
+        }
+      }
+
+      CassConsistency consistency = request->consistencies.at(level);
+      CassError error = request->batch != nullptr ? cass_batch_set_consistency(request->batch, consistency) :
+                                                    cass_statement_set_consistency(statement, consistency);
+      if(error != CASS_OK){
+        std::lock_guard<std::mutex> lock(request->mutex);
+        request->error_code = CONSISTENCY_ERROR;
+        request->error_message = "Scylla Error: Unable to set statement consistency: " + std::string(cass_error_desc(error));
+        return false;
+      }
+
+      CassFuture* result_future = request->batch != nullptr ? cass_session_execute_batch(request->valustor->session, request->batch) :
+                                                              cass_session_execute(request->valustor->session, statement);
+      if(result_future == nullptr){
+        return false;
+      }
+      cass_future_set_callback(result_future, on_request_complete, new Attempt(request, level));
+      cass_future_free(result_future); // The driver holds its own reference until the callback returns.
+      return true;
+    }
+
+    // ****************************************************************************************************
+    /// @name            execute
+    ///
+    /// @brief           Execute the request at the current consistency level, or finish it if there are none left.
+    ///                  The driver will call on_request_complete() from one of its IO threads.
+    ///                  The caller's reference to the request is handed to the attempt.
+    ///
+    static void execute(Request* request){
+      while(true){
+        size_t level;
+        {
+          std::lock_guard<std::mutex> lock(request->mutex);
+          if(request->level >= request->consistencies.size()){
+            break;
+          }
+          level = request->level;
+          if(level + 1 < request->consistencies.size() and not request->valustor->is_level_available(request->is_select, level)){
+            request->level++; // Skip a level that has been failing. The last level is always tried.
+            continue;
+          }
+          request->in_flight++;
+        }
+        if(launch(request, request->statement, level)){
+          return;
+        }
+        if(not attempt_failed(request)){
+          release(request); // A hedged attempt is still in flight and will carry on.
+          return;
+        }
+      }
+      finish(request);
+    }
+
+    // ****************************************************************************************************
+    /// @name            attempt_failed
+    ///
+    /// @brief           Account for a failed attempt.
+    ///
+    /// @return          'true' if the caller should fall back to the next consistency level, or 'false' if the request
+    ///                  has already completed or another attempt is still in flight.
+    ///
+    static bool attempt_failed(Request* request){
+      std::lock_guard<std::mutex> lock(request->mutex);
+      request->in_flight--;
+      if(request->is_completed or request->in_flight != 0){
+        return false;
+      }
+      request->level++;
+      return true;
+    }
+
+    // ****************************************************************************************************
+    /// @name            on_request_complete
+    ///
+    /// @brief           Driver callback: process the response or fall back to the next consistency level.
+    ///                  When reads are hedged, the first attempt to return an answer completes the request.
+    ///
+    static void on_request_complete(CassFuture* result_future, void* data){
+      std::unique_ptr<Attempt> attempt(static_cast<Attempt*>(data));
+      Request* request = attempt->request;
+      ValuStor* valustor = request->valustor;
+      bool is_ok = cass_future_error_code(result_future) == CASS_OK;
+      if(is_ok and request->is_select and attempt->level == 0 and valustor->read_hedge_percentile > 0){
+        valustor->record_read_latency(std::chrono::steady_clock::now() - attempt->start_time);
+      }
+      valustor->record_level_result(request->is_select, attempt->level, is_ok);
+
+      bool is_answered = false;
+      {
+        std::lock_guard<std::mutex> lock(request->mutex);
+        if(request->is_completed){
+          // Another attempt has already answered.
+        }
+        else if(not is_ok){
+          request->error_code = QUERY_ERROR;
+          request->error_message = logFutureErrorMessage(result_future, "Unable to run query");
+        }
+        else if(not request->is_select){
+          request->error_code = SUCCESS;
+          request->error_message = "Value stored successfully";
+          is_answered = true;
+        }
+        else{
+          const CassResult* cass_result = cass_future_get_result(result_future);
+          if(cass_result != nullptr){
+            valustor->read_result(cass_result, request);
+            cass_result_free(cass_result);
+            is_answered = true; // End in "success": No need to reduce consistency.
+          }
+        }
+        if(is_answered){
+          request->in_flight--;
+          request->answered_consistency = request->consistencies.at(attempt->level);
+        }
+      }
+
+      if(is_answered){
+        finish(request);
+      }
+      else if(attempt_failed(request)){
+        execute(request);
+      }
+      else{
+        release(request);
+      }
+    }
+
+    // ****************************************************************************************************
+    /// @name            read_result
+    ///
+    /// @brief           Convert the rows of a SELECT into the request's retrieved data.
+    ///
+    void read_result(const CassResult* cass_result, Request* request){
+      size_t row_count = cass_result_row_count(cass_result);
+      if(row_count != 0){
+        CassIterator* iterator = cass_iterator_from_result(cass_result);
+        while (cass_iterator_next(iterator)) {
+          //
+          // We have a row of data to process
+          //
+          const CassRow* row = cass_iterator_get_row(iterator);
+          if (row != nullptr) {
+            CassError error = CASS_OK;
+            Val_T data_gotten{};
+            const CassValue* value = cass_row_get_column(row, 0);
+            if(value != nullptr){
+              error = get(value, &data_gotten); // Get the Val_T response.
+              int32_t seconds_ttl = 0;
+              int64_t write_time = 0;
+              if(error == CASS_OK and this->is_selecting_ttl_writetime){
+                // A NULL TTL() means the row doesn't expire.
+                const CassValue* ttl_value = cass_row_get_column(row, 1);
+                if(ttl_value != nullptr and not cass_value_is_null(ttl_value)){
+                  cass_value_get_int32(ttl_value, &seconds_ttl);
+                }
+                const CassValue* writetime_value = cass_row_get_column(row, 2);
+                if(writetime_value != nullptr and not cass_value_is_null(writetime_value)){
+                  cass_value_get_int64(writetime_value, &write_time);
+                }
+              }
+              if(error == CASS_OK){
+                // Get the Key(s) that may have optionally been SELECTed.
+                error = get_keys(row, 1, request->count, request->keys, typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{});
+              }
+              if(error == CASS_OK){
+                request->retrieved_data.push_back(std::make_pair(data_gotten, request->keys));
+                request->retrieved_ttls.push_back(seconds_ttl);
+                request->retrieved_write_times.push_back(write_time);
+                request->error_code = SUCCESS;
+                request->error_message = "Successful";
+              }
+              else{
+                request->error_code = VALUE_ERROR;
+                request->error_message = "Scylla Error: Unable to get the value: " + std::string(cass_error_desc(error));
+                break; // Error: Quit out.
+              }
+            }
+            else{
+              request->error_code = VALUE_ERROR;
+              request->error_message = "Scylla Error: Unable to get the value";
+              break; // Error: Quit out.
+            }
+          }
+          else{
+            request->error_code = NOT_FOUND;
+            request->error_message = "Error: Value Not Found";
+            break; // Error: Quit out.
+          }
+        }
+        cass_iterator_free(iterator);
+      }
+      else{
+        request->error_code = NOT_FOUND;
+        request->error_message = request->count == 0 or request->count == std::tuple_size<std::tuple<Keys...>>{} ?
+                                   "Error: Value Not Found" :
+                                   "Error: Value Not Found. Did you specify the entire partition key?";
+      }
+    }
+
+    // ****************************************************************************************************
+    /// @name            finish
+    ///
+    /// @brief           Complete the request, unless another attempt already has, and release the caller's reference.
+    ///
+    static void finish(Request* request){
+      bool is_first = false;
+      {
+        std::lock_guard<std::mutex> lock(request->mutex);
+        is_first = not request->is_completed;
+        request->is_completed = true;
+      }
+      if(is_first){
+        complete(request);
+      }
+      release(request);
+    }
+
+    // ****************************************************************************************************
+    /// @name            complete
+    ///
+    /// @brief           Invoke the request's callback, backlogging a failed store() if allowed.
+    ///                  This is called exactly once per request.
+    ///
+    static void complete(Request* request){
+      ValuStor* valustor = request->valustor;
+      Callback callback = std::move(request->callback);
+      if(not request->is_select and request->batch == nullptr){
+        if(request->error_code == SUCCESS){
+          valustor->write_through(request->keys, request->value, request->seconds_ttl, request->insert_microseconds_since_epoch, false);
+        }
+        else{
+          valustor->invalidate(request->keys); // Again, in case a read cached the old value while the write was in flight.
+        }
+      }
+      if(not request->is_select and request->error_code != SUCCESS and request->insert_mode == ALLOW_BACKLOG){
+        valustor->add_to_backlog(request->keys, request->value, request->seconds_ttl, request->insert_microseconds_since_epoch);
+      }
+      ValuStor::Result result = request->is_select ?
+          ValuStor::Result(request->error_code, request->error_message, std::move(request->retrieved_data)) :
+          ValuStor::Result(request->error_code, request->error_message, request->value, std::move(request->keys));
+      result.seconds_ttls = std::move(request->retrieved_ttls);
+      result.write_times = std::move(request->retrieved_write_times);
+      result.consistency = request->answered_consistency;
+
+      //
+      // The callback belongs to the application, so don't let it take down the driver's IO thread.
+      //
+      try{
+        callback(std::move(result));
+      }
+      catch(...){}
+    }
+
+    // ****************************************************************************************************
+    /// @name            release
+    ///
+    /// @brief           Drop a reference to the request, freeing it once the last attempt or hedge timer lets go.
+    ///
+    static void release(Request* request){
+      {
+        std::lock_guard<std::mutex> lock(request->mutex);
+        if(--request->references != 0){
+          return;
+        }
+      }
+      ValuStor* valustor = request->valustor;
+      if(request->batch != nullptr){
+        cass_batch_free(request->batch);
+      }
+      else{
+        cass_statement_free(request->statement);
+      }
+      if(request->hedge_statement != nullptr){
+        cass_statement_free(request->hedge_statement);
+      }
+      delete request;
+      valustor->pending_requests--;
+    }
+
+    // ****************************************************************************************************
+    /// @name            hedge
+    ///
+    /// @brief           Called by the hedge thread once a read's first attempt has taken longer than the configured
+    ///                  latency percentile. If it is still the only attempt, the next consistency level is sent in
+    ///                  parallel with a statement of its own. This uses the hedge timer's reference to the request.
+    ///
+    void hedge(Request* request){
+      CassStatement* statement = nullptr;
+      {
+        std::lock_guard<std::mutex> lock(request->mutex);
+        if(not request->is_completed and request->in_flight == 1 and request->level == 0 and request->consistencies.size() > 1 and
+           (request->consistencies.size() == 2 or this->is_level_available(true, 1))){
+          statement = cass_prepared_bind(request->hedge_prepared);
+          if(statement != nullptr){
+            this->call_bind(statement, request->keys, typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{});
+            request->hedge_statement = statement;
+            request->level = 1;
+            request->in_flight++;
+          }
+        }
+      }
+      if(statement == nullptr){
+        release(request);
+      }
+      else if(not launch(request, statement, 1)){
+        if(attempt_failed(request)){
+          execute(request);
+        }
+        else{
+          release(request);
+        }
+      }
+    }
+
+    // ****************************************************************************************************
+    /// @name            arm_hedge
+    ///
+    /// @brief           Schedule a hedged attempt for a read if enough latency samples have been collected.
+    ///
+    void arm_hedge(Request* request, const CassPrepared* prepared_select){
+      int64_t delay_us = this->read_hedge_delay_us;
+      if(delay_us <= 0 or request->consistencies.size() < 2){
+        return;
+      }
+      request->hedge_prepared = prepared_select;
+      {
+        //
+        // Once the destructor has stopped the hedge thread, e.g. while the backlog thread warms the cache, reads aren't hedged.
+        //
+        std::lock_guard<std::mutex> lock(this->hedge_mutex);
+        if(this->is_hedge_thread_stopping){
+          return;
+        }
+        request->references++;
+        this->hedge_timers.insert(std::make_pair(std::chrono::steady_clock::now() + std::chrono::microseconds(delay_us), request));
+      }
+      this->hedge_condition.notify_one();
+    }
+
+    // ****************************************************************************************************
+    /// @name            is_level_available
+    ///
+    /// @brief           Check whether a consistency level's circuit breaker lets a request through.
+    ///                  Once a tripped level's retry time has passed, exactly one caller gets to probe it.
+    ///
+    bool is_level_available(bool is_read, size_t level){
+      CircuitBreaker& breaker = *(is_read ? this->read_breakers : this->write_breakers).at(level);
+      if(this->consistency_failure_threshold == 0 or breaker.failures < this->consistency_failure_threshold){
+        return true;
+      }
+      int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+      int64_t retry_at = breaker.retry_at;
+      return now >= retry_at and breaker.retry_at.compare_exchange_strong(retry_at, now + this->consistency_retry_us);
+    }
+
+    // ****************************************************************************************************
+    /// @name            record_level_result
+    ///
+    /// @brief           Update a consistency level's circuit breaker with the outcome of an attempt.
+    ///
+    void record_level_result(bool is_read, size_t level, bool is_ok){
+      if(this->consistency_failure_threshold == 0){
+        return;
+      }
+      CircuitBreaker& breaker = *(is_read ? this->read_breakers : this->write_breakers).at(level);
+      if(is_ok){
+        breaker.failures = 0;
+      }
+      else if(++breaker.failures == this->consistency_failure_threshold){
+        breaker.retry_at = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() +
+                           this->consistency_retry_us;
+      }
+    }
+
+    // ****************************************************************************************************
+    /// @name            record_read_latency
+    ///
+    /// @brief           Add a first-level read latency sample and periodically recompute the hedge delay.
+    ///
+    void record_read_latency(std::chrono::steady_clock::duration latency){
+      const size_t sample_count = 1024;  // The most recent samples that are kept.
+      const size_t update_interval = 64; // Samples between recalculations, and the minimum before hedging starts.
+      std::lock_guard<std::mutex> lock(this->read_latency_mutex);
+      if(this->read_latencies.size() < sample_count){
+        this->read_latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+      }
+      else{
+        this->read_latencies.at(this->read_latency_count % sample_count) = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+      }
+      this->read_latency_count++;
+      if(this->read_latency_count % update_interval == 0){
+        std::vector<int64_t> sorted = this->read_latencies;
+        auto nth = sorted.begin() + std::min(sorted.size() - 1, sorted.size() * this->read_hedge_percentile / 100);
+        std::nth_element(sorted.begin(), nth, sorted.end());
+        this->read_hedge_delay_us = std::max<int64_t>(1, *nth);
+      }
+    }
+
+    // ****************************************************************************************************
+    /// @name            run_hedge_thread
+    ///
+    /// @brief           Fire the hedge timers as they come due, until the destructor stops the thread.
+    ///
+    void run_hedge_thread(void){
+      std::unique_lock<std::mutex> lock(this->hedge_mutex);
+      while(not this->is_hedge_thread_stopping){
+        if(this->hedge_timers.empty()){
+          this->hedge_condition.wait(lock);
+        }
+        else if(this->hedge_timers.begin()->first > std::chrono::steady_clock::now()){
+          this->hedge_condition.wait_until(lock, this->hedge_timers.begin()->first);
+        }
+        else{
+          Request* request = this->hedge_timers.begin()->second;
+          this->hedge_timers.erase(this->hedge_timers.begin());
+          lock.unlock();
+          this->hedge(request);
+          lock.lock();
+        }
+      }
+    }
+
+    // ****************************************************************************************************
+    /// @name            invalidate
+    ///
+    /// @brief           Drop the cached value for the keys, if caching is enabled.
+    ///
+    void invalidate(const std::tuple<Keys...>& keys){
+      this->detach_flights(keys);
+      if(this->cache){
+        this->cache->erase(keyToBytes(keys, std::tuple_size<std::tuple<Keys...>>{},
+                                      typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{}));
+      }
+      if(this->shared_cache){
+        this->shared_cache->erase(keyToBytes(keys, std::tuple_size<std::tuple<Keys...>>{},
+                                             typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{}));
+      }
+    }
+
+    // ****************************************************************************************************
+    /// @name            detach_flights
+    ///
+    /// @brief           Stop later retrieve() calls from joining a flight that may have read the keys before a store().
+    ///                  The calls that already joined still get its result.
+    ///
+    void detach_flights(const std::tuple<Keys...>& keys){
+      if(this->is_coalescing_reads){
+        const size_t total_keys = std::tuple_size<std::tuple<Keys...>>{};
+        std::lock_guard<std::mutex> lock(this->flight_mutex);
+        for(size_t count = 0; count <= total_keys and not this->flights.empty(); count++){
+          this->flights.erase(std::to_string(count) + ":" +
+                              keyToBytes(keys, count != 0 ? count : total_keys, typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{}));
+        }
+      }
+    }
+
+    // ****************************************************************************************************
+    /// @name            lookup
+    ///
+    /// @brief           Look for the full keys in the in-process cache, then in the shared memory cache.
+    ///                  A value from the shared memory cache is not copied into the in-process cache, whose
+    ///                  entries it could otherwise overwrite with an older value.
+    ///
+    typename Cache::Lookup_t lookup(const std::string& cache_key, const std::tuple<Keys...>& keys, std::pair<Val_T, std::tuple<Keys...>>* row){
+      auto lookup = this->cache ? this->cache->find(cache_key, row) : Cache::CACHE_MISS;
+      if(lookup == Cache::CACHE_MISS and this->shared_cache){
+        std::string bytes;
+        size_t offset = 0;
+        if(this->shared_cache->find(cache_key, &bytes) and deserialize(bytes, &offset, &row->first) and offset == bytes.size()){
+          row->second = keys;
+          lookup = Cache::CACHE_HIT;
+        }
+      }
+      return lookup;
+    }
+
+    // ****************************************************************************************************
+    /// @name            share
+    ///
+    /// @brief           Put a value into the shared memory cache, if enabled.
+    ///                  Values read at a fallback consistency level are not shared.
+    ///
+    /// @param           seconds_ttl  The row's TTL, or '0' if none.
+    /// @param           write_time   The row's WRITETIME, or '0' if unknown. A value never replaces a newer write.
+    /// @param           is_read      'true' if the value was read, in which case its TTL was rounded down.
+    ///
+    void share(const std::string& cache_key, const Val_T& value, int32_t seconds_ttl, int64_t write_time, bool is_read){
+      if(this->shared_cache){
+        std::string bytes;
+        serialize(value, &bytes);
+        this->shared_cache->insert(cache_key, bytes,
+                                   seconds_ttl > 0 ? 1000L * (seconds_ttl - (is_read ? 1 : 0)) : std::numeric_limits<int64_t>::max(),
+                                   write_time);
+      }
+    }
+
+    // ****************************************************************************************************
+    /// @name            is_degraded_read
+    ///
+    /// @brief           'true' if a read was answered by a fallback consistency level rather than the first, so it is
+    ///                  more likely to be out of date and is cached for 'cache_degraded_ttl_ms' instead.
+    ///
+    bool is_degraded_read(const ValuStor::Result& result) const{
+      return result.consistency != CASS_CONSISTENCY_UNKNOWN and result.consistency != this->read_consistencies.front();
+    }
+
+    // ****************************************************************************************************
+    /// @name            stale_result
+    ///
+    /// @brief           A successful result holding an expired value from the cache, flagged as stale.
+    ///
+    static ValuStor::Result stale_result(std::pair<Val_T, std::tuple<Keys...>>&& row, const std::string& result_message){
+      std::vector<std::pair<Val_T, std::tuple<Keys...>>> retrieved_data;
+      retrieved_data.push_back(std::move(row));
+      ValuStor::Result result(SUCCESS, result_message, std::move(retrieved_data));
+      result.is_stale = true;
+      return result;
+    }
+
+    // ****************************************************************************************************
+    /// @name            last_known_result
+    ///
+    /// @brief           If enabled, replace a read that failed because the database couldn't be reached with the
+    ///                  last value cached for the key, flagged as stale. The message still describes the error.
+    ///
+    ValuStor::Result last_known_result(const std::string& cache_key, ValuStor::Result&& result){
+      std::pair<Val_T, std::tuple<Keys...>> row;
+      if(this->is_serving_stale_on_error and (result.error_code == SESSION_FAILED or result.error_code == QUERY_ERROR) and
+         this->cache->find_last_known(cache_key, &row)){
+        return stale_result(std::move(row), result.result_message);
+      }
+      return std::move(result);
+    }
+
+    // ****************************************************************************************************
+    /// @name            write_through
+    ///
+    /// @brief           Cache a value that was just stored, if caching is enabled, and keep later retrieve() calls from
+    ///                  joining a flight that may have read the old value.
+    ///
+    /// @param           is_dirty     'true' if the value is waiting in the backlog rather than in the database.
+    ///
+    void write_through(const std::tuple<Keys...>& keys, const Val_T& value, int32_t seconds_ttl, int64_t insert_microseconds_since_epoch, bool is_dirty){
+      this->detach_flights(keys);
+      if(this->cache or this->shared_cache){
+        int64_t the_time = insert_microseconds_since_epoch != 0 ?
+                            insert_microseconds_since_epoch :
+                            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        std::string cache_key = keyToBytes(keys, std::tuple_size<std::tuple<Keys...>>{}, typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{});
+        if(this->cache){
+          this->cache->write(cache_key, value, keys, seconds_ttl, the_time, is_dirty);
+        }
+
+        //
+        // Other processes can't see this process's backlog, so until it is written out they must read the database.
+        //
+        if(this->shared_cache and is_dirty){
+          this->shared_cache->erase(cache_key);
+        }
+        else{
+          this->share(cache_key, value, seconds_ttl, the_time, false);
+        }
+      }
+    }
+
+    // ****************************************************************************************************
+    /// @name            add_to_backlog
+    ///
+    /// @brief           Queue a store() for the backlog thread, timestamping it now if no time was given.
+    ///                  The value is cached as dirty, so retrieve() sees it until the backlog writes it out.
+    ///
+    void add_to_backlog(const std::tuple<Keys...>& keys, const Val_T& value, int32_t seconds_ttl, int64_t insert_microseconds_since_epoch){
+      int64_t the_time = insert_microseconds_since_epoch != 0 ?
+                          insert_microseconds_since_epoch :
+                          std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+      this->backlog_inbox_ptr->push(typename Backlog::Item(keys, value, seconds_ttl, the_time));
+
+      //
+      // A journaled write should reach the disk promptly, so move it there unless another thread already holds the backlog.
+      //
+      if(this->backlog_queue_ptr->is_journaled()){
+        std::unique_lock<std::mutex> lock(*this->backlog_mutex_ptr, std::try_to_lock);
+        if(lock.owns_lock()){
+          this->backlog_queue_ptr->drain(*this->backlog_inbox_ptr);
+        }
+      }
+      this->write_through(keys, value, seconds_ttl, the_time, true);
+    }
+
+    // ****************************************************************************************************
+    /// @name            fulfill
+    ///
+    /// @brief           Create a callback that fulfills the given promise.
+    ///
+    static Callback fulfill(const std::shared_ptr<std::promise<ValuStor::Result>>& promise){
+      return [promise](ValuStor::Result result){
+        promise->set_value(std::move(result));
+      };
+    }
+
+  public:
+    // ****************************************************************************************************
+    /// @name            retrieve
+    ///
+    /// @brief           Get the value associated with the provided key without blocking.
+    ///                  The consistency levels are tried in order and the callback is invoked from one of the driver's IO threads.
+    ///                  If the request cannot be sent at all (e.g. no connection), the callback is invoked immediately.
+    ///
+    /// @param           keys
+    /// @param           callback
+    /// @param           count
+    /// @param           timeout_ms   Total time allowed across all consistency levels. '0' uses 'read_timeout_ms'.
+    ///
+    void retrieve(Keys... keys, Callback callback, size_t count = 0, uint32_t timeout_ms = 0){
+      std::vector<std::pair<Val_T, std::tuple<Keys...>>> retrieved_data;
 
       //
-      // Wait for the thread to initialize and detach it from this thread.
+      // A lookup of the full key may be answered by the cache.
       //
-      backlog_thread.detach();
-      while(not are_pointers_setup){
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+      const bool is_cacheable = (this->cache or this->shared_cache) and (count == 0 or count == std::tuple_size<std::tuple<Keys...>>{});
+      if(is_cacheable){
+        std::string cache_key = keyToBytes(std::tuple<Keys...>(keys...), std::tuple_size<std::tuple<Keys...>>{},
+                                           typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{});
+        std::pair<Val_T, std::tuple<Keys...>> row;
+        auto lookup = this->lookup(cache_key, std::tuple<Keys...>(keys...), &row);
+        switch(lookup){
+          case Cache::CACHE_HIT:
+            retrieved_data.push_back(std::move(row));
+            callback(ValuStor::Result(SUCCESS, "Successful", std::move(retrieved_data)));
+            return;
+          case Cache::CACHE_STALE:
+          case Cache::CACHE_REFRESH:
+            //
+            // Answer with the expired value now. The first to find it also refreshes it in the background.
+            //
+            callback(stale_result(std::move(row), "Successful"));
+            if(lookup == Cache::CACHE_STALE){
+              return;
+            }
+            callback = [](ValuStor::Result){};
+            break;
+          case Cache::CACHE_NOT_FOUND:
+            callback(ValuStor::Result(NOT_FOUND, "Error: Value Not Found", std::move(retrieved_data)));
+            return;
+          case Cache::CACHE_MISS:
+            break;
+        }
       }
-    } // run_backlog_thread()
 
-  public:
+      this->fetch(keys..., std::move(callback), count, timeout_ms);
+    }
+
     // ****************************************************************************************************
-    /// @name            constructor
+    /// @name            retrieve_async
     ///
-    /// @brief           Create a ValuStor, loading the configuration from the supplied configuration.
+    /// @brief           Get the value associated with the provided key without blocking.
     ///
-    ValuStor(const std::map<std::string, std::string> configuration):
-      cluster(nullptr),
-      session(nullptr),
-      prepared_insert(nullptr),
-      is_initialized(false),
-      default_backlog_mode(ALLOW_BACKLOG),
-      do_terminate_thread_ptr(nullptr),
-      is_processing_backlog_ptr(new std::atomic<bool>(false)),
-      backlog_mutex_ptr(nullptr),
-      backlog_queue_ptr(nullptr)
-    {
+    /// @param           keys
+    /// @param           count
+    /// @param           timeout_ms   Total time allowed across all consistency levels. '0' uses 'read_timeout_ms'.
+    ///
+    /// @return          A future that will hold the same result that retrieve() would have returned.
+    ///
+    std::future<ValuStor::Result> retrieve_async(Keys... keys, size_t count = 0, uint32_t timeout_ms = 0){
+      std::shared_ptr<std::promise<ValuStor::Result>> promise(new std::promise<ValuStor::Result>());
+      std::future<ValuStor::Result> future = promise->get_future();
+      this->retrieve(keys..., fulfill(promise), count, timeout_ms);
+      return future;
+    }
+
+  private:
+    // ****************************************************************************************************
+    /// @name            fetch
+    ///
+    /// @brief           The database half of retrieve(), for a lookup that the cache did not answer.
+    ///
+    void fetch(Keys... keys, Callback callback, size_t count, uint32_t timeout_ms){
+      std::vector<std::pair<Val_T, std::tuple<Keys...>>> retrieved_data;
+      const bool is_cacheable = (this->cache or this->shared_cache) and (count == 0 or count == std::tuple_size<std::tuple<Keys...>>{});
+      const std::string cache_key = is_cacheable ? keyToBytes(std::tuple<Keys...>(keys...), std::tuple_size<std::tuple<Keys...>>{},
+                                                              typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{}) : "";
+
       //
-      // Use the configuration supplied.
+      // Join an identical retrieve() that is already in flight, or lead one that others may join.
+      // A flight that may run past this call's own timeout isn't joined, and this call doesn't replace it either.
       //
-      for(const auto& pair : configuration){
-        std::string key = trim(pair.first);
-        if(this->default_config.count(key) != 0){
-          this->config[key] = pair.second;
+      std::string flight_key;
+      std::shared_ptr<Flight> flight;
+      if(this->is_coalescing_reads){
+        flight_key = std::to_string(count) + ":" +
+                     keyToBytes(std::tuple<Keys...>(keys...), count != 0 ? count : std::tuple_size<std::tuple<Keys...>>{},
+                                typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{});
+        const uint32_t total_timeout_ms = timeout_ms != 0 ? timeout_ms : this->read_timeout_ms;
+        const auto deadline = total_timeout_ms != 0 ? std::chrono::steady_clock::now() + std::chrono::milliseconds(total_timeout_ms) :
+                                                      std::chrono::steady_clock::time_point::max();
+        {
+          std::lock_guard<std::mutex> lock(this->flight_mutex);
+          auto found = this->flights.find(flight_key);
+          if(found != this->flights.end() and found->second->deadline <= deadline){
+            found->second->waiters.push_back(std::move(callback));
+            return;
+          }
+          if(found == this->flights.end()){
+            flight.reset(new Flight());
+            flight->deadline = deadline;
+            this->flights[flight_key] = flight;
+          }
         }
       }
 
       //
-      // Add in any missing defaults
+      // Lead the flight. A store() of the key may have detached it from 'flights' already, so that later calls send a new SELECT.
       //
-      for(const auto& pair : this->default_config){
-        std::string key = trim(pair.first);
-        if(this->config.count(key) == 0){
-          this->config[key] = pair.second;
-        }
+      if(flight){
+        Callback user_callback = std::move(callback);
+        callback = [this, flight_key, flight, user_callback](ValuStor::Result result){
+          std::vector<Callback> waiters;
+          {
+            std::lock_guard<std::mutex> lock(this->flight_mutex);
+            auto found = this->flights.find(flight_key);
+            if(found != this->flights.end() and found->second == flight){
+              this->flights.erase(found);
+            }
+            waiters = std::move(flight->waiters);
+          }
+          for(auto& waiter : waiters){
+            try{
+              waiter(result);
+            }
+            catch(...){}
+          }
+          user_callback(std::move(result));
+        };
       }
 
       //
-      // Configure the connection
+      // Cache the value read, before any callbacks run so that the next retrieve() finds it.
       //
-      this->configure();
+      if(is_cacheable){
+        uint64_t cache_version = this->cache ? this->cache->version(cache_key) : 0;
+        Callback user_callback = std::move(callback);
+        std::tuple<Keys...> key_tuple(keys...);
+        callback = [this, cache_key, cache_version, key_tuple, user_callback](ValuStor::Result result){
+          if(result.error_code == SUCCESS and result.results.size() == 1){
+            int32_t seconds_ttl = result.seconds_ttls.size() == 1 ? result.seconds_ttls.front() : 0;
+            int64_t write_time = result.write_times.size() == 1 ? result.write_times.front() : 0;
+            if(this->cache){
+              this->cache->insert(cache_key, cache_version, result.results.front().first, result.results.front().second,
+                                  seconds_ttl, write_time, this->is_degraded_read(result));
+            }
+            if(not this->is_degraded_read(result)){
+              this->share(cache_key, result.results.front().first, seconds_ttl, write_time, true);
+            }
+          }
+          else if(result.error_code == NOT_FOUND and this->cache){
+            this->cache->insert_not_found(cache_key, cache_version, key_tuple, this->is_degraded_read(result));
+          }
+          user_callback(this->last_known_result(cache_key, std::move(result)));
+        };
+      }
+
+      if(not this->is_initialized){
+        callback(ValuStor::Result(SESSION_FAILED, "Scylla Error: Could not connect to server(s)", std::move(retrieved_data)));
+        return;
+      }
+      else if(this->prepared_selects.size() == 0){
+        callback(ValuStor::Result(PREPARED_SELECT_FAILED, "Scylla Error: Prepared Select Failed", std::move(retrieved_data)));
+        return;
+      }
 
       //
-      // Start the backlog thread (which will perform initialization)
+      // count = # of keys in the WHERE clause, or '0' for all.
+      // -----
+      //   1: SELECT v,k2,k3 FROM cache.tbl131 WHERE k1=?
+      //   2: SELECT v,k3 FROM cache.tbl131 WHERE k1=? AND k2=?
+      //   3: SELECT v FROM cache.tbl131 WHERE k1=? AND k2=? AND k3=?
       //
-      this->run_backlog_thread();
+      auto prepared_select = this->prepared_selects.count(count) != 0 ? this->prepared_selects.at(count) :
+                                                                        this->prepared_selects.rbegin()->second;
+      CassStatement* statement = cass_prepared_bind(prepared_select);
+      if(statement == nullptr){
+        callback(ValuStor::Result(UNKNOWN_ERROR, "Scylla Error", std::move(retrieved_data)));
+        return;
+      }
+
+      //
+      // Binding fails for the keys beyond 'count', which is expected.
+      //
+      bind(statement, 0, keys...);
+
+      this->pending_requests++;
+      Request* request = new Request(this, statement, this->read_consistencies, true, count,
+                                     std::tuple<Keys...>(keys...), Val_T{}, 0, DISALLOW_BACKLOG, 0,
+                                     timeout_ms != 0 ? timeout_ms : this->read_timeout_ms, std::move(callback));
+      if(this->read_hedge_percentile > 0){
+        this->arm_hedge(request, prepared_select);
+      }
+      execute(request);
     }
 
     // ****************************************************************************************************
-    /// @name            constructor
+    /// @name            call_retrieve
     ///
-    /// @brief           Create a ValuStor, loading the configuration from a file.
+    /// @brief           Internal version of the non-blocking retrieve() used by retrieve_many().
     ///
-    ValuStor(const std::string config_filename):
-      cluster(nullptr),
-      session(nullptr),
-      prepared_insert(nullptr),
-      is_initialized(false),
-      default_backlog_mode(ALLOW_BACKLOG),
-      do_terminate_thread_ptr(nullptr),
-      is_processing_backlog_ptr(new std::atomic<bool>(false)),
-      backlog_mutex_ptr(nullptr),
-      backlog_queue_ptr(nullptr)
-    {
-      //
-      // Load in the config
-      //
-      config = default_config;
-      try{
-        std::ifstream config_file(config_filename);
-        std::string line;
-        while(std::getline(config_file, line)){
-          auto comment_marker = line.find("#");
-          if(comment_marker != std::string::npos) {
-            line = line.substr(0, comment_marker);
-          }
+    template <size_t... IndexSequence>
+    void call_retrieve(const std::tuple<Keys...>& t, Callback callback, size_t count, Indices<IndexSequence...>){
+      this->retrieve(std::get<IndexSequence>(t)..., std::move(callback), count);
+    }
 
-          auto equal_marker = line.find("=");
-          if(equal_marker != std::string::npos){
-            this->config[trim(line.substr(0, equal_marker))] = trim(line.substr(equal_marker + 1));
-          }
+    template <size_t... IndexSequence>
+    void call_fetch(const std::tuple<Keys...>& t, Callback callback, size_t count, Indices<IndexSequence...>){
+      this->fetch(std::get<IndexSequence>(t)..., std::move(callback), count, 0);
+    }
+
+    template <size_t... IndexSequence>
+    void call_bind(CassStatement* statement, const std::tuple<Keys...>& t, Indices<IndexSequence...>){
+      bind(statement, 0, std::get<IndexSequence>(t)...);
+    }
+
+    // ****************************************************************************************************
+    /// @name            retrieve_in
+    ///
+    /// @brief           Retrieve several full keys that differ only in their last (clustering) key with a single
+    ///                  SELECT ... IN query, then split the rows back out into one result per key.
+    ///
+    void retrieve_in(const std::vector<std::tuple<Keys...>>& keys,
+                     const std::vector<size_t>& group,
+                     std::vector<std::unique_ptr<ValuStor::Result>>& completed,
+                     std::function<void(void)> done){
+      const size_t total_keys = std::tuple_size<std::tuple<Keys...>>{};
+      const size_t bucket = this->prepared_in_selects.lower_bound(group.size())->first;
+      CassStatement* statement = cass_prepared_bind(this->prepared_in_selects.at(bucket));
+      if(statement == nullptr){
+        for(size_t ndx : group){
+          completed.at(ndx).reset(new ValuStor::Result(UNKNOWN_ERROR, "Scylla Error", std::vector<std::pair<Val_T, std::tuple<Keys...>>>()));
         }
+        done();
+        return;
       }
-      catch(const std::exception& exception){}
 
       //
-      // Configure the connection
+      // The first key binds the WHERE clause and the first IN value. The unused IN values repeat the last key.
       //
-      this->configure();
+      this->call_bind(statement, keys.at(group.front()), typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{});
+      for(size_t ndx = 1; ndx < bucket; ndx++){
+        const std::tuple<Keys...>& key = keys.at(group.at(std::min(ndx, group.size() - 1)));
+        bind(statement, total_keys - 1 + ndx, std::get<std::tuple_size<std::tuple<Keys...>>::value - 1>(key));
+      }
 
-      //
-      // Start the backlog thread (which will perform initialization)
-      //
-      this->run_backlog_thread();
+      std::vector<uint64_t> cache_versions;
+      if(this->cache){
+        for(size_t ndx : group){
+          cache_versions.push_back(this->cache->version(keyToBytes(keys.at(ndx), total_keys,
+                                                                   typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{})));
+        }
+      }
+
+      this->pending_requests++;
+      execute(new Request(this, statement, this->read_consistencies, true, total_keys - 1,
+                          std::tuple<Keys...>(keys.at(group.front())), Val_T{}, 0, DISALLOW_BACKLOG, 0, this->read_timeout_ms,
+                          [this, &keys, &completed, group, cache_versions, done](ValuStor::Result result){
+        const size_t total_keys = std::tuple_size<std::tuple<Keys...>>{};
+        auto sequence = typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{};
+        std::map<std::string, size_t> rows;
+        for(size_t row = 0; row < result.results.size(); row++){
+          rows[keyToBytes(result.results.at(row).second, total_keys, sequence)] = row;
+        }
+        for(size_t position = 0; position < group.size(); position++){
+          size_t ndx = group.at(position);
+          std::vector<std::pair<Val_T, std::tuple<Keys...>>> retrieved_data;
+          auto row = rows.find(keyToBytes(keys.at(ndx), total_keys, sequence));
+          if(row != rows.end()){
+            const Val_T& value = result.results.at(row->second).first;
+            int32_t seconds_ttl = row->second < result.seconds_ttls.size() ? result.seconds_ttls.at(row->second) : 0;
+            int64_t write_time = row->second < result.write_times.size() ? result.write_times.at(row->second) : 0;
+            if(this->cache){
+              this->cache->insert(row->first, cache_versions.at(position), value, keys.at(ndx), seconds_ttl, write_time,
+                                  this->is_degraded_read(result));
+            }
+            if(not this->is_degraded_read(result)){
+              this->share(row->first, value, seconds_ttl, write_time, true);
+            }
+            retrieved_data.push_back(std::make_pair(value, keys.at(ndx)));
+            completed.at(ndx).reset(new ValuStor::Result(SUCCESS, "Successful", std::move(retrieved_data)));
+          }
+          else if(result.error_code == SUCCESS or result.error_code == NOT_FOUND){
+            if(this->cache){
+              this->cache->insert_not_found(keyToBytes(keys.at(ndx), total_keys, sequence), cache_versions.at(position), keys.at(ndx),
+                                            this->is_degraded_read(result));
+            }
+            completed.at(ndx).reset(new ValuStor::Result(NOT_FOUND, "Error: Value Not Found", std::move(retrieved_data)));
+          }
+          else{
+            completed.at(ndx).reset(new ValuStor::Result(this->last_known_result(keyToBytes(keys.at(ndx), total_keys, sequence),
+                                                         ValuStor::Result(result.error_code, result.result_message, std::move(retrieved_data)))));
+          }
+        }
+        done();
+      }));
     }
 
+  public:
     // ****************************************************************************************************
-    /// @name            destructor
+    /// @name            retrieve_many
     ///
-    /// @brief           Close the connection, the backlog thread, and free up allocations.
+    /// @brief           Get the values associated with each of the provided keys.
+    ///                  All of the SELECTs are sent at once, so the total time is roughly a single round trip.
+    ///                  When several full keys differ only in a clustering key, they are fetched together in
+    ///                  a single SELECT ... IN query.
     ///
+    /// @param           keys
+    /// @param           count
     ///
-    ~ValuStor(void)
-    {
-      //
-      // Terminate the backlog thread, but be careful as state is shared.
-      // By terminating the thread and clearing the queue while holding the lock, we can prevent most race conditions.
-      //
-      bool was_backlog_running = false;
-      {
-        std::lock_guard<std::mutex> lock(*this->backlog_mutex_ptr);
-        was_backlog_running = *this->is_processing_backlog_ptr;
-        this->backlog_queue_ptr->clear();
-        *this->do_terminate_thread_ptr = true;
-      }
+    /// @return          One result per key, in the same order as the keys.
+    ///
+    std::vector<ValuStor::Result> retrieve_many(const std::vector<std::tuple<Keys...>>& keys, size_t count = 0){
+      const size_t total_keys = std::tuple_size<std::tuple<Keys...>>{};
+      auto sequence = typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{};
 
       //
-      // If the backlog thread was processing, we must wait for it to finish so it isn't accessing any of this' data.
-      // When it isn't in processing, it cannot reenter processing without knowing that "do_terminate_thread" was set.
-      // If the backlog was not running, it is impossible for there to be a race condition.
+      // Each group is sent as one query: either a single key, or keys sharing everything but the last (clustering) key.
       //
-      if(was_backlog_running){
-        while(*this->is_processing_backlog_ptr){
-          std::this_thread::sleep_for(std::chrono::seconds(1));
+      std::vector<std::vector<size_t>> groups;
+      std::vector<std::unique_ptr<ValuStor::Result>> completed(keys.size());
+      size_t partition_keys = this->partition_key_count;
+      size_t max_in_keys = this->prepared_in_selects.size() != 0 ? this->prepared_in_selects.rbegin()->first : 0;
+      const bool is_grouped = this->is_initialized and max_in_keys != 0 and (count == 0 or count == total_keys) and
+                              partition_keys != 0 and partition_keys < total_keys;
+      if(is_grouped){
+        std::map<std::string, size_t> group_by_prefix;
+        for(size_t ndx = 0; ndx < keys.size(); ndx++){
+          std::pair<Val_T, std::tuple<Keys...>> row;
+          auto lookup = this->lookup(keyToBytes(keys.at(ndx), total_keys, sequence), keys.at(ndx), &row);
+          if(lookup != Cache::CACHE_MISS){
+            std::vector<std::pair<Val_T, std::tuple<Keys...>>> retrieved_data;
+            if(lookup == Cache::CACHE_NOT_FOUND){
+              completed.at(ndx).reset(new ValuStor::Result(NOT_FOUND, "Error: Value Not Found", std::move(retrieved_data)));
+            }
+            else if(lookup == Cache::CACHE_HIT){
+              retrieved_data.push_back(std::move(row));
+              completed.at(ndx).reset(new ValuStor::Result(SUCCESS, "Successful", std::move(retrieved_data)));
+            }
+            else{
+              completed.at(ndx).reset(new ValuStor::Result(stale_result(std::move(row), "Successful")));
+            }
+            if(lookup == Cache::CACHE_REFRESH){
+              this->call_fetch(keys.at(ndx), [](ValuStor::Result){}, 0, sequence);
+            }
+            continue; // Answered by the cache.
+          }
+          std::string prefix = keyToBytes(keys.at(ndx), total_keys - 1, sequence);
+          auto found = group_by_prefix.find(prefix);
+          if(found == group_by_prefix.end() or groups.at(found->second).size() >= max_in_keys){
+            group_by_prefix[prefix] = groups.size();
+            groups.push_back(std::vector<size_t>());
+          }
+          groups.at(group_by_prefix.at(prefix)).push_back(ndx);
         }
       }
-
-      //
-      // Close up the cassandra connection.
-      //
-      for(const auto& pair : this->prepared_selects){
-        if(pair.second != nullptr){
-          cass_prepared_free(pair.second);
+      else{
+        for(size_t ndx = 0; ndx < keys.size(); ndx++){
+          groups.push_back(std::vector<size_t>(1, ndx));
         }
       }
-      this->prepared_selects.clear();
-      if(this->prepared_insert != nullptr){
-        cass_prepared_free(this->prepared_insert);
+
+      pipeline(groups.size(), std::max<size_t>(groups.size(), 1), [&](size_t group_ndx, std::function<void(void)> done){
+        const std::vector<size_t>& group = groups.at(group_ndx);
+        Callback callback = [&completed, &group, done](ValuStor::Result result){
+          completed.at(group.front()).reset(new ValuStor::Result(std::move(result)));
+          done();
+        };
+        if(group.size() > 1){
+          this->retrieve_in(keys, group, completed, done);
+        }
+        else if(is_grouped){
+          //
+          // The cache was already checked above. Checking it again would count the key twice toward admission.
+          //
+          this->call_fetch(keys.at(group.front()), std::move(callback), count, sequence);
+        }
+        else{
+          this->call_retrieve(keys.at(group.front()), std::move(callback), count, sequence);
+        }
+      });
+
+      std::vector<ValuStor::Result> results;
+      results.reserve(keys.size());
+      for(auto& result : completed){
+        results.push_back(std::move(*result));
       }
-      if(this->session != nullptr){
-        cass_session_free(this->session);
+      return results;
+    }
+
+    // ****************************************************************************************************
+    /// @name            warm_cache
+    ///
+    /// @brief           Preload the cache with the values of the provided full keys, e.g. the hot keys after a restart.
+    ///                  At most 'cache_warm_max_in_flight' SELECTs are outstanding at once. Blocks until all have completed.
+    ///
+    /// @param           keys
+    ///
+    /// @return          The number of keys that were found and cached.
+    ///
+    size_t warm_cache(const std::vector<std::tuple<Keys...>>& keys){
+      if(not this->cache and not this->shared_cache){
+        return 0;
       }
-      if(this->cluster != nullptr){
-        cass_cluster_free(this->cluster);
+      std::atomic<size_t> found(0);
+      pipeline(keys.size(), std::max(1, str_to_int(this->config.at("cache_warm_max_in_flight"), 64)),
+               [&](size_t ndx, std::function<void(void)> done){
+        this->call_fetch(keys.at(ndx), [&found, done](ValuStor::Result result){
+                           if(result and not result.is_stale){
+                             found++;
+                           }
+                           done();
+                         }, 0, typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{});
+      });
+      return found;
+    }
+
+    // ****************************************************************************************************
+    /// @name            warm_cache_from_file
+    ///
+    /// @brief           Preload the cache from a key file, such as one written by save_cache_snapshot().
+    ///                  The file has one key per line, with multiple keys separated by tabs.
+    ///                  Empty lines, lines starting with '#', and lines that can't be parsed are skipped.
+    ///
+    /// @param           filename
+    ///
+    /// @return          The number of keys that were found and cached.
+    ///
+    size_t warm_cache_from_file(const std::string& filename){
+      std::vector<std::tuple<Keys...>> keys;
+      try{
+        std::ifstream key_file(filename);
+        std::string line;
+        while(std::getline(key_file, line)){
+          if(line.size() != 0 and line.back() == '\r'){
+            line.pop_back();
+          }
+          std::tuple<Keys...> key;
+          if(line.size() != 0 and line.front() != '#' and
+             lineToKey(line, &key, typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{})){
+            keys.push_back(std::move(key));
+          }
+        }
       }
+      catch(const std::exception& exception){}
+      return this->warm_cache(keys);
     }
 
-  private:
     // ****************************************************************************************************
-    /// @name            logFutureErrorMessage
+    /// @name            save_cache_snapshot
     ///
-    static std::string logFutureErrorMessage(CassFuture* future, const std::string& description){
-      const char* message;
-      size_t message_length;
-      if(future != nullptr){
-        cass_future_error_message(future, &message, &message_length);
+    /// @brief           Write the keys of the cached values to a key file that warm_cache_from_file() can load,
+    ///                  the most valuable entries first. Only the keys are saved; the values are read afresh when loaded.
+    ///
+    /// @param           filename
+    ///
+    /// @return          The number of keys written, or '0' if the cache is disabled or the file couldn't be written.
+    ///
+    size_t save_cache_snapshot(const std::string& filename){
+      if(not this->cache){
+        return 0;
       }
-      return "Scylla Error: " + description + ": '" + std::string(message, message_length) + "'";
+      std::vector<std::tuple<Keys...>> keys = this->cache->snapshot();
+      std::ofstream key_file(filename, std::ios::trunc);
+      for(const auto& key : keys){
+        key_file << keyToLine(key, typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{}) << "\n";
+      }
+      key_file.close();
+      return key_file ? keys.size() : 0;
     }
 
-  public:
+    #if defined(VALUSTOR_COROUTINES)
+    // ****************************************************************************************************
+    /// @name            co_retrieve
+    ///
+    /// @brief           Get the value associated with the provided key from a coroutine.
+    ///                  For example:
+    ///                    {
+    ///                      auto result = co_await store.co_retrieve(1234);
+    ///                    }
+    ///
+    /// @param           keys
+    /// @param           count
+    /// @param           timeout_ms   Total time allowed across all consistency levels. '0' uses 'read_timeout_ms'.
+    ///
+    /// @return          An awaitable that resumes with the same result that retrieve() would have returned.
+    ///
+    Awaitable co_retrieve(Keys... keys, size_t count = 0, uint32_t timeout_ms = 0){
+      return Awaitable([this, keys..., count, timeout_ms](Callback callback){
+        this->retrieve(keys..., std::move(callback), count, timeout_ms);
+      });
+    }
+    #endif
+
     // ****************************************************************************************************
     /// @name            retrieve
     ///
@@ -849,125 +3813,45 @@ class ValuStor
     ///
     /// @param           keys
     /// @param           count
+    /// @param           timeout_ms   Total time allowed across all consistency levels. '0' uses 'read_timeout_ms'.
     ///
     /// @return          If 'result.first', the string value in 'result.second', otherwise not found.
     ///
-    ValuStor::Result retrieve(Keys... keys, size_t count = 0){
-      ErrorCode_t error_code = UNKNOWN_ERROR;
-      std::string error_message = "Scylla Error";
-
-      std::vector<std::pair<Val_T, std::tuple<Keys...>>> retrieved_data;
+    ValuStor::Result retrieve(Keys... keys, size_t count = 0, uint32_t timeout_ms = 0){
+      return this->retrieve_async(keys..., count, timeout_ms).get();
+    }
 
-      if(not this->is_initialized){
-        error_code = SESSION_FAILED;
-        error_message = "Scylla Error: Could not connect to server(s)";
-      }
-      else if(this->prepared_selects.size() == 0){
-        error_code = PREPARED_SELECT_FAILED;
-        error_message = "Scylla Error: Prepared Select Failed";
+  private:
+    // ****************************************************************************************************
+    /// @name            bind_insert
+    ///
+    /// @brief           Bind the keys, value, and TTL to a statement from the prepared INSERT.
+    ///
+    CassError bind_insert(CassStatement* statement, const Keys&... keys, const Val_T& value, int32_t seconds_ttl){
+      CassError error = CASS_OK;
+      std::pair<CassError, size_t> error_keys = ValuStor::bind(statement, (size_t)0, keys...);
+      if(error_keys.first == CASS_OK){
+        std::pair<CassError, size_t> error_value = ValuStor::bind(statement, error_keys.second, value);
+        if(error_value.first == CASS_OK){
+          std::pair<CassError, size_t> error_ttl = ValuStor::bind(statement, error_keys.second + 1, seconds_ttl);
+          error = error_ttl.first;
+        }
+        else{
+          error = error_value.first;
+        }
       }
       else{
-        //
-        // count = # of keys in the WHERE clause, or '0' for all.
-        // -----
-        //   1: SELECT v,k2,k3 FROM cache.tbl131 WHERE k1=?
-        //   2: SELECT v,k3 FROM cache.tbl131 WHERE k1=? AND k2=?
-        //   3: SELECT v FROM cache.tbl131 WHERE k1=? AND k2=? AND k3=?
-        //
-        auto prepared_select = this->prepared_selects.count(count) != 0 ? this->prepared_selects.at(count) :
-                                                                          this->prepared_selects.rbegin()->second;
-        CassStatement* statement = cass_prepared_bind(prepared_select);
-        if(statement != nullptr){
-          std::pair<CassError, size_t> bind_error = bind(statement, 0, keys...);
-          CassError error = bind_error.first;
-          if(error != CASS_OK and false){
-            error_code = BIND_ERROR;
-            error_message = "Scylla Error: Unable to bind parameters: " + std::string(cass_error_desc(error));
-          }
-          else{
-            for(const auto& level : this->read_consistencies){
-              error = cass_statement_set_consistency(statement, level);
-              if(error != CASS_OK){
-                error_code = CONSISTENCY_ERROR;
-                error_message = "Scylla Error: Unable to set statement consistency: " + std::string(cass_error_desc(error));
-              }
-              else{
-                CassFuture* result_future = cass_session_execute(this->session, statement);
-                if(result_future != nullptr){
-                  cass_future_wait_timed(result_future, 2000000L); // Wait up to 2s
-                  if (cass_future_error_code(result_future) != CASS_OK) {
-                    error_code = QUERY_ERROR;
-                    error_message = logFutureErrorMessage(result_future, "Unable to run query");
-                  }
-                  else{
-                    const CassResult* cass_result = cass_future_get_result(result_future);
-                    if(cass_result != nullptr){
-                      size_t row_count = cass_result_row_count(cass_result);
-                      if(row_count != 0){
-                        CassIterator* iterator = cass_iterator_from_result(cass_result);
-                        while (cass_iterator_next(iterator)) {
-                          //
-                          // We have a row of data to process
-                          //
-                          const CassRow* row = cass_iterator_get_row(iterator);
-                          if (row != nullptr) {
-                            CassError error = CASS_OK;
-                            Val_T data_gotten{};
-                            const CassValue* value = cass_row_get_column(row, 0);
-                            if(value != nullptr){
-                              error = get(value, &data_gotten); // Get the Val_T response.
-                              if(error == CASS_OK){
-                                error = get(row, 1, count, &keys...); // Get the Key(s) that may have optionally been SELECTed.
-                              }
-                              if(error == CASS_OK){
-                                retrieved_data.push_back(std::make_pair(data_gotten, std::tuple<Keys...>(keys...)));
-                                error_code = SUCCESS;
-                                error_message = "Successful";
-                              }
-                              else{
-                                error_code = VALUE_ERROR;
-                                error_message = "Scylla Error: Unable to get the value: " + std::string(cass_error_desc(error));
-                                break; // Error: Quit out.
-                              }
-                            }
-                            else{
-                              error_code = VALUE_ERROR;
-                              error_message = "Scylla Error: Unable to get the value";
-                              break; // Error: Quit out.
-                            }
-                          }
-                          else{
-                            error_code = NOT_FOUND;
-                            error_message = "Error: Value Not Found";
-                            break; // Error: Quit out.
-                          }
-                        }
-                        cass_iterator_free(iterator);
-                      }
-                      else{
-                        error_code = NOT_FOUND;
-                        error_message = count == 0 or count == std::tuple_size<std::tuple<Keys...>>{} ? "Error: Value Not Found" :
-                                                        "Error: Value Not Found. Did you specify the entire partition key?";
-                      }
-                      cass_result_free(cass_result);
-                      cass_future_free(result_future); // Free it here, because we break out of the for loop.
-                      break; // End in "success": No need to reduce consistency.
-                    }
-                  }
-                  cass_future_free(result_future);
-                }
-              }
-            }
-          }
-          cass_statement_free(statement);
-        }
+        error = error_keys.first;
       }
+      return error;
+    }
 
-      return ValuStor::Result(error_code, error_message, std::move(retrieved_data));
-
+    template <size_t... IndexSequence>
+    CassError call_bind_insert(CassStatement* statement, const std::tuple<Keys...>& t, const Val_T& value, int32_t seconds_ttl,
+                               Indices<IndexSequence...>){
+      return this->bind_insert(statement, std::get<IndexSequence>(t)..., value, seconds_ttl);
     }
 
-  private:
     // ****************************************************************************************************
     /// @name            store
     ///
@@ -987,34 +3871,35 @@ class ValuStor
     // ****************************************************************************************************
     /// @name            store
     ///
-    /// @brief           Get the value associated with the provided keys.
+    /// @brief           Store the value associated with the provided keys without blocking.
+    ///                  The consistency levels are tried in order and the callback is invoked from one of the driver's IO threads.
+    ///                  If the request cannot be sent at all (e.g. backlogged or no connection), the callback is invoked immediately.
     ///
     /// @param           keys
     /// @param           value
+    /// @param           callback
+    /// @param           seconds_ttl
+    /// @param           insert_mode
+    /// @param           insert_microseconds_since_epoch
+    /// @param           timeout_ms   Total time allowed across all consistency levels. '0' uses 'write_timeout_ms'.
     ///
-    /// @return          'true' if successful, 'false' otherwise.
-    ///
-    ValuStor::Result store(const Keys&... keys,
-                           const Val_T& value,
-                           int32_t seconds_ttl = 0,
-                           InsertMode_t insert_mode = DEFAULT_BACKLOG_MODE,
-                           int64_t insert_microseconds_since_epoch = 0){
+    void store(const Keys&... keys,
+               const Val_T& value,
+               Callback callback,
+               int32_t seconds_ttl = 0,
+               InsertMode_t insert_mode = DEFAULT_BACKLOG_MODE,
+               int64_t insert_microseconds_since_epoch = 0,
+               uint32_t timeout_ms = 0){
 
       if(insert_mode == DEFAULT_BACKLOG_MODE){
         insert_mode = this->default_backlog_mode;
       }
+      this->invalidate(std::tuple<Keys...>(keys...));
       ErrorCode_t error_code = UNKNOWN_ERROR;
       std::string error_message = "Scylla Error";
 
       if(insert_mode == USE_ONLY_BACKLOG){
-        int64_t the_time = insert_microseconds_since_epoch != 0 ?
-                            insert_microseconds_since_epoch :
-                            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-        {
-          std::lock_guard<std::mutex> lock(*this->backlog_mutex_ptr);
-          this->backlog_queue_ptr->push_back(std::tuple<std::tuple<Keys...>,Val_T,int32_t,int64_t>(
-                                               std::tuple<Keys...>(keys...), value, seconds_ttl, the_time));
-        }
+        this->add_to_backlog(std::tuple<Keys...>(keys...), value, seconds_ttl, insert_microseconds_since_epoch);
         error_code = SUCCESS;
         error_message = "Backlogged";
       }
@@ -1033,70 +3918,312 @@ class ValuStor
             cass_statement_set_timestamp(statement, insert_microseconds_since_epoch);
           } // if
 
-          CassError error = CASS_OK;
-          {
-            std::pair<CassError, size_t> error_keys = ValuStor::bind(statement, (size_t)0, keys...);
-            if(error_keys.first == CASS_OK){
-              std::pair<CassError, size_t> error_value = ValuStor::bind(statement, error_keys.second, value);
-              if(error_value.first == CASS_OK){
-                std::pair<CassError, size_t> error_ttl = ValuStor::bind(statement, error_keys.second + 1, seconds_ttl);
-                error = error_ttl.first;
-              }
-              else{
-                error = error_value.first;
-              }
-            }
-            else{
-              error = error_keys.first;
-            }
-          }
+          CassError error = this->bind_insert(statement, keys..., value, seconds_ttl);
           if(error != CASS_OK){
             error_code = BIND_ERROR;
             error_message = "Scylla Error: Unable to bind parameters: " + std::string(cass_error_desc(error));
+            cass_statement_free(statement);
           }
           else{
-            for(const auto& level : this->write_consistencies){
-              error = cass_statement_set_consistency(statement, level);
-              if(error != CASS_OK){
-                error_code = CONSISTENCY_ERROR;
-                error_message = "Scylla Error: Unable to set statement consistency: " + std::string(cass_error_desc(error));
-              }
-              else{
-                CassFuture* result_future = cass_session_execute(this->session, statement);
-                if(result_future != nullptr){
-                  cass_future_wait_timed(result_future, 2000000L); // Wait up to 2s
-                  if (cass_future_error_code(result_future) != CASS_OK) {
-                    error_code = QUERY_ERROR;
-                    error_message = logFutureErrorMessage(result_future, "Unable to run query");
-                  }
-                  else{
-                    error_code = SUCCESS;
-                    error_message = "Value stored successfully";
-                    cass_future_free(result_future);  // Free it here after a successful insertion, but prior to breaking out of the loop.
-                    break;
-                  }
-                  cass_future_free(result_future);
-                }
-              }
-            }
+            this->pending_requests++;
+            execute(new Request(this, statement, this->write_consistencies, false, 0, std::tuple<Keys...>(keys...),
+                                value, seconds_ttl, insert_mode, insert_microseconds_since_epoch,
+                                timeout_ms != 0 ? timeout_ms : this->write_timeout_ms, std::move(callback)));
+            return;
           }
-          cass_statement_free(statement);
         }
       }
 
       if(error_code != SUCCESS and insert_mode == ALLOW_BACKLOG){
-        int64_t the_time = insert_microseconds_since_epoch != 0 ?
-                            insert_microseconds_since_epoch :
-                            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        this->add_to_backlog(std::tuple<Keys...>(keys...), value, seconds_ttl, insert_microseconds_since_epoch);
+      }
+
+      callback(ValuStor::Result(error_code, error_message, value, std::tuple<Keys...>(keys...)));
+    }
+
+    // ****************************************************************************************************
+    /// @name            store_async
+    ///
+    /// @brief           Store the value associated with the provided keys without blocking.
+    ///
+    /// @param           keys
+    /// @param           value
+    ///
+    /// @return          A future that will hold the same result that store() would have returned.
+    ///
+    std::future<ValuStor::Result> store_async(const Keys&... keys,
+                                              const Val_T& value,
+                                              int32_t seconds_ttl = 0,
+                                              InsertMode_t insert_mode = DEFAULT_BACKLOG_MODE,
+                                              int64_t insert_microseconds_since_epoch = 0,
+                                              uint32_t timeout_ms = 0){
+      std::shared_ptr<std::promise<ValuStor::Result>> promise(new std::promise<ValuStor::Result>());
+      std::future<ValuStor::Result> future = promise->get_future();
+      this->store(keys..., value, fulfill(promise), seconds_ttl, insert_mode, insert_microseconds_since_epoch, timeout_ms);
+      return future;
+    }
+
+  private:
+    // ****************************************************************************************************
+    /// @name            call_store
+    ///
+    /// @brief           Internal version of the non-blocking store() used by store_many().
+    ///
+    template <size_t... IndexSequence>
+    void call_store(const std::tuple<Keys...>& t,
+                    const Val_T& value,
+                    Callback callback,
+                    int32_t seconds_ttl,
+                    InsertMode_t insert_mode,
+                    Indices<IndexSequence...>) {
+      this->store(std::get<IndexSequence>(t)..., value, std::move(callback), seconds_ttl, insert_mode, 0);
+    }
+
+    // ****************************************************************************************************
+    /// @name            pipeline
+    ///
+    /// @brief           Call launch(ndx, done) for each index, keeping at most 'max_in_flight' launches outstanding.
+    ///                  Each launch must eventually call done(). Returns once they all have.
+    ///
+    static void pipeline(size_t total, size_t max_in_flight, const std::function<void(size_t, std::function<void(void)>)>& launch){
+      std::mutex mutex;
+      std::condition_variable condition;
+      size_t in_flight = 0;
+
+      auto done = [&](void){
+        std::lock_guard<std::mutex> lock(mutex);
+        in_flight--;
+        condition.notify_one();
+      };
+
+      for(size_t ndx = 0; ndx < total; ndx++){
         {
-          std::lock_guard<std::mutex> lock(*this->backlog_mutex_ptr);
-          this->backlog_queue_ptr->push_back(std::tuple<std::tuple<Keys...>,Val_T,int32_t,int64_t>(
-                                              std::tuple<Keys...>(keys...), value, seconds_ttl, the_time));
+          std::unique_lock<std::mutex> lock(mutex);
+          condition.wait(lock, [&](void){ return in_flight < max_in_flight; });
+          in_flight++;
+        }
+        launch(ndx, done);
+      }
+
+      //
+      // Wait for the stragglers.
+      //
+      std::unique_lock<std::mutex> lock(mutex);
+      condition.wait(lock, [&](void){ return in_flight == 0; });
+    }
+
+    // ****************************************************************************************************
+    /// @name            partition_key
+    ///
+    /// @brief           The serialized partition key of a key tuple.
+    ///                  Rows with the same partition key are stored on the same replicas (they share a token).
+    ///                  If the partition key could not be read from the schema, all of the keys are used.
+    ///
+    std::string partition_key(const std::tuple<Keys...>& keys){
+      size_t count = this->partition_key_count;
+      return keyToBytes(keys, count != 0 ? count : std::tuple_size<std::tuple<Keys...>>{},
+                        typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{});
+    }
+
+  public:
+    // ****************************************************************************************************
+    /// @name            store_many
+    ///
+    /// @brief           Store many values, keeping up to 'max_in_flight' writes outstanding at a time.
+    ///                  Each item uses the normal write consistency fallback and backlog rules.
+    ///
+    /// @param           items           (keys, value, seconds_ttl)
+    /// @param           insert_mode
+    /// @param           max_in_flight   '0' uses the 'store_many_max_in_flight' configuration.
+    ///
+    /// @return          One result per item, in the same order as the items.
+    ///
+    std::vector<ValuStor::Result> store_many(const std::vector<std::tuple<std::tuple<Keys...>, Val_T, int32_t>>& items,
+                                             InsertMode_t insert_mode = DEFAULT_BACKLOG_MODE,
+                                             size_t max_in_flight = 0){
+      std::vector<std::unique_ptr<ValuStor::Result>> completed(items.size());
+      pipeline(items.size(), max_in_flight != 0 ? max_in_flight : this->store_many_max_in_flight,
+               [&](size_t ndx, std::function<void(void)> done){
+        const auto& item = items.at(ndx);
+        this->call_store(std::get<0>(item), std::get<1>(item), [&completed, ndx, done](ValuStor::Result result){
+                           completed.at(ndx).reset(new ValuStor::Result(std::move(result)));
+                           done();
+                         },
+                         std::get<2>(item), insert_mode, typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{});
+      });
+
+      std::vector<ValuStor::Result> results;
+      results.reserve(items.size());
+      for(auto& result : completed){
+        results.push_back(std::move(*result));
+      }
+      return results;
+    }
+
+    // ****************************************************************************************************
+    /// @name            store_batched
+    ///
+    /// @brief           Store many values, grouping the items that share a partition into UNLOGGED batches.
+    ///                  Each batch is routed by the driver to a replica that owns the partition, and uses the
+    ///                  normal write consistency fallback. Items in a failed batch are backlogged individually.
+    ///
+    /// @param           items           (keys, value, seconds_ttl)
+    /// @param           insert_mode
+    /// @param           max_in_flight   '0' uses the 'store_many_max_in_flight' configuration.
+    ///
+    /// @return          One result per item, in the same order as the items.
+    ///
+    std::vector<ValuStor::Result> store_batched(const std::vector<std::tuple<std::tuple<Keys...>, Val_T, int32_t>>& items,
+                                                InsertMode_t insert_mode = DEFAULT_BACKLOG_MODE,
+                                                size_t max_in_flight = 0){
+      if(insert_mode == DEFAULT_BACKLOG_MODE){
+        insert_mode = this->default_backlog_mode;
+      }
+      if(insert_mode == USE_ONLY_BACKLOG or not this->is_initialized or this->prepared_insert == nullptr){
+        return this->store_many(items, insert_mode, max_in_flight);
+      }
+
+      //
+      // Group the items by partition, in the order each partition is first seen.
+      // Large partitions are split so that no batch exceeds 'store_batch_max_statements'.
+      //
+      std::vector<std::vector<size_t>> groups;
+      {
+        std::map<std::string, size_t> group_by_partition;
+        for(size_t ndx = 0; ndx < items.size(); ndx++){
+          std::string partition = this->partition_key(std::get<0>(items.at(ndx)));
+          auto found = group_by_partition.find(partition);
+          if(found == group_by_partition.end() or groups.at(found->second).size() >= this->store_batch_max_statements){
+            group_by_partition[partition] = groups.size();
+            groups.push_back(std::vector<size_t>());
+          }
+          groups.at(group_by_partition.at(partition)).push_back(ndx);
+        }
+      }
+
+      std::vector<std::unique_ptr<ValuStor::Result>> completed(items.size());
+      pipeline(groups.size(), max_in_flight != 0 ? max_in_flight : this->store_many_max_in_flight,
+               [&](size_t group_ndx, std::function<void(void)> done){
+        const std::vector<size_t>& group = groups.at(group_ndx);
+
+        //
+        // A lone item doesn't need a batch.
+        //
+        if(group.size() == 1){
+          const auto& item = items.at(group.front());
+          this->call_store(std::get<0>(item), std::get<1>(item), [&completed, &group, done](ValuStor::Result result){
+                             completed.at(group.front()).reset(new ValuStor::Result(std::move(result)));
+                             done();
+                           },
+                           std::get<2>(item), insert_mode, typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{});
+          return;
+        }
+
+        //
+        // Every item in the group gets the same outcome as the batch.
+        //
+        auto complete_group = [this, &items, &completed, &group, insert_mode, done](ErrorCode_t error_code, const std::string& error_message){
+          for(size_t ndx : group){
+            const auto& item = items.at(ndx);
+            if(error_code == SUCCESS){
+              this->write_through(std::get<0>(item), std::get<1>(item), std::get<2>(item), 0, false);
+            }
+            else{
+              this->invalidate(std::get<0>(item));
+            }
+            if(error_code != SUCCESS and insert_mode == ALLOW_BACKLOG){
+              this->add_to_backlog(std::get<0>(item), std::get<1>(item), std::get<2>(item), 0);
+            }
+            completed.at(ndx).reset(new ValuStor::Result(error_code, error_message, std::get<1>(item), std::tuple<Keys...>(std::get<0>(item))));
+          }
+          done();
+        };
+
+        CassBatch* batch = cass_batch_new(CASS_BATCH_TYPE_UNLOGGED);
+        CassError error = CASS_OK;
+        for(size_t ndx : group){
+          const auto& item = items.at(ndx);
+          this->invalidate(std::get<0>(item));
+          CassStatement* statement = cass_prepared_bind(this->prepared_insert);
+          if(statement == nullptr){
+            error = CASS_ERROR_LIB_BAD_PARAMS;
+          }
+          else{
+            error = this->call_bind_insert(statement, std::get<0>(item), std::get<1>(item), std::get<2>(item),
+                                           typename Sequencer<std::tuple_size<std::tuple<Keys...>>{}>::Indices{});
+            if(error == CASS_OK){
+              error = cass_batch_add_statement(batch, statement);
+            }
+            cass_statement_free(statement); // The batch keeps its own reference.
+          }
+          if(error != CASS_OK){
+            break;
+          }
         }
+        if(error != CASS_OK){
+          cass_batch_free(batch);
+          complete_group(BIND_ERROR, "Scylla Error: Unable to bind parameters: " + std::string(cass_error_desc(error)));
+          return;
+        }
+
+        this->pending_requests++;
+        execute(new Request(this, batch, this->write_consistencies, this->write_timeout_ms, [complete_group](ValuStor::Result result){
+          complete_group(result.error_code, result.error_code == SUCCESS ? "Value stored successfully" : result.result_message);
+        }));
+      });
+
+      std::vector<ValuStor::Result> results;
+      results.reserve(items.size());
+      for(auto& result : completed){
+        results.push_back(std::move(*result));
       }
+      return results;
+    }
 
-      return ValuStor::Result(error_code, error_message, value, std::tuple<Keys...>(keys...));
+    #if defined(VALUSTOR_COROUTINES)
+    // ****************************************************************************************************
+    /// @name            co_store
+    ///
+    /// @brief           Store the value associated with the provided keys from a coroutine.
+    ///                  For example:
+    ///                    {
+    ///                      auto result = co_await store.co_store(1234, "value");
+    ///                    }
+    ///
+    /// @param           keys
+    /// @param           value
+    ///
+    /// @return          An awaitable that resumes with the same result that store() would have returned.
+    ///
+    Awaitable co_store(const Keys&... keys,
+                       const Val_T& value,
+                       int32_t seconds_ttl = 0,
+                       InsertMode_t insert_mode = DEFAULT_BACKLOG_MODE,
+                       int64_t insert_microseconds_since_epoch = 0,
+                       uint32_t timeout_ms = 0){
+      return Awaitable([this, keys..., value, seconds_ttl, insert_mode, insert_microseconds_since_epoch, timeout_ms](Callback callback){
+        this->store(keys..., value, std::move(callback), seconds_ttl, insert_mode, insert_microseconds_since_epoch, timeout_ms);
+      });
+    }
+    #endif
 
+    // ****************************************************************************************************
+    /// @name            store
+    ///
+    /// @brief           Get the value associated with the provided keys.
+    ///
+    /// @param           keys
+    /// @param           value
+    ///
+    /// @return          'true' if successful, 'false' otherwise.
+    ///
+    ValuStor::Result store(const Keys&... keys,
+                           const Val_T& value,
+                           int32_t seconds_ttl = 0,
+                           InsertMode_t insert_mode = DEFAULT_BACKLOG_MODE,
+                           int64_t insert_microseconds_since_epoch = 0,
+                           uint32_t timeout_ms = 0){
+      return this->store_async(keys..., value, seconds_ttl, insert_mode, insert_microseconds_since_epoch, timeout_ms).get();
     }
 
   //
@@ -1237,7 +4364,7 @@ class ValuStor
       }
       else{
         if(column > count){
-          const CassValue* cass_value = cass_row_get_column(row, column - count);
+          const CassValue* cass_value = cass_row_get_column(row, column - count + this->key_column_offset());
           if(cass_value != nullptr){
             error = get(cass_value, value);
           }
@@ -1254,7 +4381,7 @@ class ValuStor
       }
       else{
         if(column > count){
-          const CassValue* cass_value = cass_row_get_column(row, column - count);
+          const CassValue* cass_value = cass_row_get_column(row, column - count + this->key_column_offset());
           if(cass_value != nullptr){
             error = get(cass_value, value);
           }
@@ -1266,6 +4393,18 @@ class ValuStor
       return error;
     }
 
+    //
+    // The TTL() and WRITETIME() columns, when selected, sit between the value and the keys.
+    //
+    size_t key_column_offset(void) const{
+      return this->is_selecting_ttl_writetime ? 2 : 0;
+    }
+
+    template<size_t... IndexSequence>
+    CassError get_keys(const CassRow* row, const size_t column, const size_t count, std::tuple<Keys...>& keys, Indices<IndexSequence...>){
+      return get(row, column, count, &std::get<IndexSequence>(keys)...);
+    }
+
   private:
     static std::string convertToStr(const int8_t& value)  {  return std::to_string(value); }
     static std::string convertToStr(const int16_t& value) {  return std::to_string(value); }
@@ -1279,11 +4418,11 @@ class ValuStor
     static std::string convertToStr(const cass_bool_t& value) { return std::to_string(value == cass_true); }
     static std::string convertToStr(const bool& value) {     return std::to_string(value); }
     static std::string convertToStr(const CassUuid& value) {
-      char* output = nullptr;
+      char output[CASS_UUID_STRING_LENGTH];
       cass_uuid_string(value, output);
-      return output != nullptr ? std::string(output) : "";
+      return std::string(output);
     }
-    static std::string convertToStr(const std::vector<uint8_t>& value) { return std::string(value); }
+    static std::string convertToStr(const std::vector<uint8_t>& value) { return std::string(value.begin(), value.end()); }
     #if defined(NLOHMANN_JSON_HPP)
     static std::string convertToStr(const nlohmann::json& value){ return value.dump(); }
     #endif
@@ -1308,7 +4447,7 @@ class ValuStor
       cass_uuid_from_string(source.c_str(), dest);
     }
     static void convertFromStr(const std::string& source, std::vector<uint8_t>* dest)  {
-      *dest = source;
+      dest->assign(source.begin(), source.end());
     }
     #if defined(NLOHMANN_JSON_HPP)
     static void convertFromStr(const std::string& source, nlohmann::json* dest)  {
@@ -1316,6 +4455,254 @@ class ValuStor
     }
     #endif
 
+    //
+    // serialize() functions append a compact binary form of a key or value, e.g. for grouping and hashing keys.
+    // Fixed-size types are copied as-is. Variable-size types are prefixed with their length.
+    //
+    template<typename Fixed_T>
+    static void serialize_fixed(const Fixed_T& value, std::string* dest){
+      dest->append(reinterpret_cast<const char*>(&value), sizeof(Fixed_T));
+    }
+    static void serialize_bytes(const char* data, size_t length, std::string* dest){
+      serialize_fixed(static_cast<uint32_t>(length), dest);
+      dest->append(data, length);
+    }
+    static void serialize(const int8_t& value, std::string* dest)      { serialize_fixed(value, dest); }
+    static void serialize(const int16_t& value, std::string* dest)     { serialize_fixed(value, dest); }
+    static void serialize(const int32_t& value, std::string* dest)     { serialize_fixed(value, dest); }
+    static void serialize(const uint32_t& value, std::string* dest)    { serialize_fixed(value, dest); }
+    static void serialize(const int64_t& value, std::string* dest)     { serialize_fixed(value, dest); }
+    static void serialize(const float& value, std::string* dest)       { serialize_fixed(value, dest); }
+    static void serialize(const double& value, std::string* dest)      { serialize_fixed(value, dest); }
+    static void serialize(const cass_bool_t& value, std::string* dest) { serialize_fixed(static_cast<uint8_t>(value == cass_true), dest); }
+    static void serialize(const bool& value, std::string* dest)        { serialize_fixed(static_cast<uint8_t>(value), dest); }
+    static void serialize(const CassUuid& value, std::string* dest){
+      serialize_fixed(value.time_and_version, dest);
+      serialize_fixed(value.clock_seq_and_node, dest);
+    }
+    static void serialize(const std::string& value, std::string* dest) { serialize_bytes(value.data(), value.size(), dest); }
+    static void serialize(const char* value, std::string* dest)        { serialize_bytes(value, std::strlen(value), dest); }
+    static void serialize(const std::vector<uint8_t>& value, std::string* dest){
+      serialize_bytes(reinterpret_cast<const char*>(value.data()), value.size(), dest);
+    }
+    #if defined(NLOHMANN_JSON_HPP)
+    static void serialize(const nlohmann::json& value, std::string* dest){ serialize(value.dump(), dest); }
+    #endif
+
+    //
+    // deserialize() functions read back what serialize() wrote, advancing the offset.
+    // They return 'false' if the source is too short.
+    //
+    template<typename Fixed_T>
+    static bool deserialize_fixed(const std::string& source, size_t* offset, Fixed_T* dest){
+      if(source.size() - *offset < sizeof(Fixed_T)){
+        return false;
+      }
+      std::memcpy(dest, source.data() + *offset, sizeof(Fixed_T));
+      *offset += sizeof(Fixed_T);
+      return true;
+    }
+    static bool deserialize_bytes(const std::string& source, size_t* offset, const char** data, size_t* length){
+      uint32_t size;
+      if(not deserialize_fixed(source, offset, &size) or source.size() - *offset < size){
+        return false;
+      }
+      *data = source.data() + *offset;
+      *length = size;
+      *offset += size;
+      return true;
+    }
+    static bool deserialize(const std::string& source, size_t* offset, int8_t* dest)  { return deserialize_fixed(source, offset, dest); }
+    static bool deserialize(const std::string& source, size_t* offset, int16_t* dest) { return deserialize_fixed(source, offset, dest); }
+    static bool deserialize(const std::string& source, size_t* offset, int32_t* dest) { return deserialize_fixed(source, offset, dest); }
+    static bool deserialize(const std::string& source, size_t* offset, uint32_t* dest){ return deserialize_fixed(source, offset, dest); }
+    static bool deserialize(const std::string& source, size_t* offset, int64_t* dest) { return deserialize_fixed(source, offset, dest); }
+    static bool deserialize(const std::string& source, size_t* offset, float* dest)   { return deserialize_fixed(source, offset, dest); }
+    static bool deserialize(const std::string& source, size_t* offset, double* dest)  { return deserialize_fixed(source, offset, dest); }
+    static bool deserialize(const std::string& source, size_t* offset, cass_bool_t* dest){
+      uint8_t value;
+      if(not deserialize_fixed(source, offset, &value)){
+        return false;
+      }
+      *dest = value != 0 ? cass_true : cass_false;
+      return true;
+    }
+    static bool deserialize(const std::string& source, size_t* offset, bool* dest){
+      uint8_t value;
+      if(not deserialize_fixed(source, offset, &value)){
+        return false;
+      }
+      *dest = value != 0;
+      return true;
+    }
+    static bool deserialize(const std::string& source, size_t* offset, CassUuid* dest){
+      return deserialize_fixed(source, offset, &dest->time_and_version) and deserialize_fixed(source, offset, &dest->clock_seq_and_node);
+    }
+    static bool deserialize(const std::string& source, size_t* offset, std::string* dest){
+      const char* data;
+      size_t length;
+      if(not deserialize_bytes(source, offset, &data, &length)){
+        return false;
+      }
+      dest->assign(data, length);
+      return true;
+    }
+    static bool deserialize(const std::string& source, size_t* offset, std::vector<uint8_t>* dest){
+      const char* data;
+      size_t length;
+      if(not deserialize_bytes(source, offset, &data, &length)){
+        return false;
+      }
+      dest->assign(data, data + length);
+      return true;
+    }
+    #if defined(NLOHMANN_JSON_HPP)
+    static bool deserialize(const std::string& source, size_t* offset, nlohmann::json* dest){
+      std::string text;
+      if(not deserialize(source, offset, &text)){
+        return false;
+      }
+      *dest = nlohmann::json::parse(text, nullptr, false);
+      return not dest->is_discarded();
+    }
+    #endif
+
+    //
+    // heap_size() functions estimate the memory a value owns beyond sizeof() itself, for the cache's byte budget.
+    //
+    template<typename Fixed_T>
+    static size_t heap_size(const Fixed_T&){ return 0; }
+    static size_t heap_size(const std::string& value){ return value.capacity(); }
+    static size_t heap_size(const std::vector<uint8_t>& value){ return value.capacity(); }
+    #if defined(NLOHMANN_JSON_HPP)
+    static size_t heap_size(const nlohmann::json& value){
+      size_t bytes = 0;
+      if(value.is_string()){
+        bytes += sizeof(std::string) + value.get_ref<const std::string&>().capacity();
+      }
+      else if(value.is_object() or value.is_array()){
+        bytes += value.is_object() ? sizeof(nlohmann::json::object_t) : sizeof(nlohmann::json::array_t);
+        for(auto it = value.begin(); it != value.end(); ++it){
+          //
+          // An object member also costs its key and a tree node of about four pointers.
+          //
+          bytes += sizeof(nlohmann::json) + heap_size(it.value()) + (value.is_object() ? it.key().capacity() + 4 * sizeof(void*) : 0);
+        }
+      }
+      return bytes;
+    }
+    #endif
+
+    // ****************************************************************************************************
+    /// @name            keyToBytes
+    ///
+    /// @brief           Serialize the first 'count' keys of a key tuple.
+    ///
+    template<size_t... IndexSequence>
+    static std::string keyToBytes(const std::tuple<Keys...>& keys, size_t count, Indices<IndexSequence...>){
+      std::string bytes;
+      int expand[] = {0, (IndexSequence < count ? (serialize(std::get<IndexSequence>(keys), &bytes), 0) : 0)...};
+      (void)expand;
+      return bytes;
+    }
+
+    // ****************************************************************************************************
+    /// @name            bytesToKey
+    ///
+    /// @brief           Read back a key tuple that keyToBytes() serialized in full.
+    ///
+    /// @return          'false' if the source is too short.
+    ///
+    template<size_t... IndexSequence>
+    static bool bytesToKey(const std::string& source, size_t* offset, std::tuple<Keys...>* keys, Indices<IndexSequence...>){
+      bool is_valid = true;
+      int expand[] = {0, (is_valid = is_valid and deserialize(source, offset, &std::get<IndexSequence>(*keys)), 0)...};
+      (void)expand;
+      return is_valid;
+    }
+
+    //
+    // Key files hold one key per line, with its keys separated by tabs.
+    // Tabs, line breaks, and backslashes within a key are escaped with a backslash.
+    //
+    static std::string escape(const std::string& field){
+      std::string escaped;
+      for(char c : field){
+        switch(c){
+          case '\\': escaped += "\\\\"; break;
+          case '\t':  escaped += "\\t"; break;
+          case '\n':  escaped += "\\n"; break;
+          case '\r':  escaped += "\\r"; break;
+          default:    escaped += c;
+        }
+      }
+      return escaped;
+    }
+
+    static std::string unescape(const std::string& field){
+      std::string unescaped;
+      for(size_t ndx = 0; ndx < field.size(); ndx++){
+        char c = field.at(ndx);
+        if(c == '\\' and ndx + 1 < field.size()){
+          c = field.at(++ndx);
+          c = c == 't' ? '\t' : c == 'n' ? '\n' : c == 'r' ? '\r' : c;
+        }
+        unescaped += c;
+      }
+      return unescaped;
+    }
+
+    //
+    // Floating point keys are written with enough digits to read back the same value, which std::to_string() doesn't.
+    //
+    template<typename T>
+    static std::string keyFieldToStr(const T& field){ return convertToStr(field); }
+    static std::string keyFieldToStr(const float& field){ return floatToStr(field, std::numeric_limits<float>::max_digits10); }
+    static std::string keyFieldToStr(const double& field){ return floatToStr(field, std::numeric_limits<double>::max_digits10); }
+
+    static std::string floatToStr(double field, int digits){
+      char buffer[32];
+      snprintf(buffer, sizeof(buffer), "%.*g", digits, field);
+      return buffer;
+    }
+
+    // ****************************************************************************************************
+    /// @name            keyToLine
+    ///
+    /// @brief           Format a key tuple as a line of a key file, without the line break.
+    ///
+    template<size_t... IndexSequence>
+    static std::string keyToLine(const std::tuple<Keys...>& keys, Indices<IndexSequence...>){
+      std::string line;
+      int expand[] = {0, (line += (IndexSequence != 0 ? "\t" : "") + escape(keyFieldToStr(std::get<IndexSequence>(keys))), 0)...};
+      (void)expand;
+      return line;
+    }
+
+    // ****************************************************************************************************
+    /// @name            lineToKey
+    ///
+    /// @brief           Parse a line of a key file.
+    ///
+    /// @return          'false' if the line doesn't have one field per key.
+    ///
+    template<size_t... IndexSequence>
+    static bool lineToKey(const std::string& line, std::tuple<Keys...>* keys, Indices<IndexSequence...>){
+      std::vector<std::string> fields;
+      size_t start = 0;
+      for(size_t tab = line.find('\t'); tab != std::string::npos; tab = line.find('\t', start)){
+        fields.push_back(unescape(line.substr(start, tab - start)));
+        start = tab + 1;
+      }
+      fields.push_back(unescape(line.substr(start)));
+      if(fields.size() != std::tuple_size<std::tuple<Keys...>>{}){
+        return false;
+      }
+      int expand[] = {0, (convertFromStr(fields.at(IndexSequence), &std::get<IndexSequence>(*keys)), 0)...};
+      (void)expand;
+      return true;
+    }
+
   public:
     // ****************************************************************************************************
     /// @name            valueToString
@@ -0,0 +1,51 @@
+#include "ValuStor.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+//
+// Measures store() throughput into the backlog with many producer threads.
+// The host is not expected to be reachable, so every write stays in the backlog.
+//
+// Usage: ./benchmark [threads] [stores per thread] [backlog journal directory]
+//
+int main(int argc, char* argv[]){
+  const int thread_count = argc > 1 ? std::stoi(argv[1]) : 32;
+  const int stores_per_thread = argc > 2 ? std::stoi(argv[2]) : 100000;
+  const std::string journal_dir = argc > 3 ? argv[3] : "";
+
+  //
+  // CREATE TABLE cache.benchmark (k int, t int, v text, PRIMARY KEY (k, t));
+  //
+  ValuStor::ValuStor<std::string, int32_t, int32_t> store(
+   {
+    {"table", "cache.benchmark"},
+    {"key_field", "k,t"},
+    {"value_field", "v"},
+    {"hosts", "127.0.0.2"},
+    {"default_backlog_mode", "2"},
+    {"backlog_journal_dir", journal_dir}
+  });
+
+  const std::string value(64, 'v');
+  std::vector<std::thread> producers;
+  auto start = std::chrono::steady_clock::now();
+  for(int thread = 0; thread < thread_count; thread++){
+    producers.emplace_back([&store, &value, thread, stores_per_thread](void){
+      for(int ndx = 0; ndx < stores_per_thread; ndx++){
+        store.store(ndx, thread, value);
+      }
+    });
+  }
+  for(auto& producer : producers){
+    producer.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << thread_count << " threads x " << stores_per_thread << " stores: " << seconds << " s, "
+            << static_cast<long>(thread_count * static_cast<double>(stores_per_thread) / seconds) << " stores/s" << std::endl;
+  return 0;
+}
@@ -1,4 +1,5 @@
 #!/bin/sh
-g++ -Wall -Wextra -g -O2 -std=c++11 -fPIC -DPIC main.cpp -o main -lstdc++ -L/usr/local/lib -lcassandra -lpthread -I..
+g++ -Wall -Wextra -g -O2 -std=c++11 -fPIC -DPIC main.cpp -o main -lstdc++ -L/usr/local/lib -lcassandra -lpthread -lrt -I..
+g++ -Wall -Wextra -g -O2 -std=c++11 -fPIC -DPIC benchmark.cpp -o benchmark -lstdc++ -L/usr/local/lib -lcassandra -lpthread -lrt -I..
 
 
@@ -48,6 +48,7 @@ int main(void){
   #endif
 
   cout << "#include \"ValuStor.hpp\"" << endl;
+  cout << "#include <future>" << endl;
   cout << "#include <iostream>" << endl;
   cout << "int main(void){" << endl;
   cout << "  CassUuidGen* uuid_gen = cass_uuid_gen_new();" << endl;
@@ -107,7 +108,8 @@ int main(void){
            << "{\"password\", \"\"},"
            << "{\"hosts\", \"127.0.0.1\"},"
            << "{\"server_trusted_cert\", \"/etc/scylla/keys/scylla.crt\"}"
-           << "});";
+           << "});" << endl
+           << "  typedef ValuStor::ValuStor<" << val << ", " << key << ">::Result Result;";
 
       int ndx = 0;
       for(auto& k : vals_for_testing.at(key)){
@@ -119,6 +121,25 @@ int main(void){
              << "if(not result2){ std::cout << \"READ ERROR\" << std::endl; }"
              << "} else { std::cout << \"WRITE ERROR: "
              << "tbl" << std::to_string(x-1) << " (" << key << ") => " << "(" << val << ")\" << std::endl; }}";
+
+        //
+        // The same round trip through store_async()/retrieve_async() and through the callback overloads.
+        //
+        cout << endl
+             << "  {auto result = store.store_async(" << k << ", " << v << ", 0).get();"
+             << " if(result){ auto result2 = store.retrieve_async(" << k << ").get(); "
+             << "if(not result2){ std::cout << \"ASYNC READ ERROR\" << std::endl; }"
+             << "} else { std::cout << \"ASYNC WRITE ERROR: "
+             << "tbl" << std::to_string(x-1) << " (" << key << ") => " << "(" << val << ")\" << std::endl; }}";
+
+        cout << endl
+             << "  {std::promise<Result> stored;"
+             << " store.store(" << k << ", " << v << ", [&stored](Result result){ stored.set_value(std::move(result)); }, 0);"
+             << " if(stored.get_future().get()){ std::promise<Result> retrieved;"
+             << " store.retrieve(" << k << ", [&retrieved](Result result){ retrieved.set_value(std::move(result)); }); "
+             << "if(not retrieved.get_future().get()){ std::cout << \"CALLBACK READ ERROR\" << std::endl; }"
+             << "} else { std::cout << \"CALLBACK WRITE ERROR: "
+             << "tbl" << std::to_string(x-1) << " (" << key << ") => " << "(" << val << ")\" << std::endl; }}";
       } // for
 
       cout << endl << "}" 